@@ -0,0 +1,735 @@
+// micro and macro benchmarks, comparing sqlitepp with the sqlite C API
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+#include <sqlitepp/bulk_insert.hpp>
+#include <sqlitepp/config.hpp>
+
+// Usage: sqlitepp_bench [--json] [--quick] [--configs] [--filter=<substring>]
+//
+// Each case is run with sqlitepp and with the sqlite C API directly, against an
+// in-memory DB and a DB in $TMPDIR (default /tmp). Results are written to stdout
+// as CSV, or as JSON with --json
+//
+// With --configs, every case is repeated under each of the process-wide memory
+// configurations in make_configs(), to show the effect of sqlite::Config settings
+
+namespace
+{
+    struct Result
+    {
+        std::string config;
+        std::string name;
+        std::string db;
+        std::string impl;
+        long iterations;
+        double ns_per_op;
+    };
+
+    // setup runs untimed. body is timed, and must perform 'iterations' operations
+    struct Case
+    {
+        std::string name;
+        long iterations;
+        std::function<void(sqlite3 *)> setup;
+        std::function<void(sqlite::Connection &, long)> wrapped;
+        std::function<void(sqlite3 *, long)> raw;
+    };
+
+    const std::string text_value(32, 'x');
+
+    void check(int status, sqlite3 * db)
+    {
+        if(status != SQLITE_OK && status != SQLITE_ROW && status != SQLITE_DONE)
+        {
+            std::cerr << "sqlite error: " << sqlite3_errmsg(db) << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    void raw_exec(sqlite3 * db, const char * sql)
+    {
+        check(sqlite3_exec(db, sql, nullptr, nullptr, nullptr), db);
+    }
+
+    sqlite3_stmt * raw_prepare(sqlite3 * db, const char * sql)
+    {
+        sqlite3_stmt * stmt = nullptr;
+        check(sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr), db);
+        return stmt;
+    }
+
+    void create_table(sqlite3 * db)
+    {
+        raw_exec(db, "CREATE TABLE t(id INTEGER PRIMARY KEY, a INTEGER, b REAL, c TEXT);");
+    }
+
+    void fill_table(sqlite3 * db, long rows)
+    {
+        create_table(db);
+        raw_exec(db, "BEGIN;");
+        auto stmt = raw_prepare(db, "INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+        for(long i = 0; i < rows; ++i)
+        {
+            sqlite3_bind_int64(stmt, 1, i);
+            sqlite3_bind_double(stmt, 2, i * 0.5);
+            sqlite3_bind_text(stmt, 3, text_value.c_str(), text_value.size(), SQLITE_STATIC);
+            check(sqlite3_step(stmt), db);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+        raw_exec(db, "COMMIT;");
+    }
+
+    const long table_rows = 10000;
+
+    std::vector<Case> make_cases()
+    {
+        std::vector<Case> cases;
+
+        cases.push_back({"prepare", 20000, create_table,
+            [](sqlite::Connection & db, long n)
+            {
+                for(long i = 0; i < n; ++i)
+                    db.create_statement("SELECT a, b, c FROM t WHERE id = ?;");
+            },
+            [](sqlite3 * db, long n)
+            {
+                for(long i = 0; i < n; ++i)
+                    sqlite3_finalize(raw_prepare(db, "SELECT a, b, c FROM t WHERE id = ?;"));
+            }});
+
+        cases.push_back({"bind_index", 1000000, create_table,
+            [](sqlite::Connection & db, long n)
+            {
+                auto stmt = db.create_statement("INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+                for(long i = 0; i < n; ++i)
+                {
+                    stmt.bind(1, static_cast<sqlite3_int64>(i));
+                    stmt.bind(2, i * 0.5);
+                    stmt.bind(3, text_value);
+                }
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+                for(long i = 0; i < n; ++i)
+                {
+                    sqlite3_bind_int64(stmt, 1, i);
+                    sqlite3_bind_double(stmt, 2, i * 0.5);
+                    sqlite3_bind_text(stmt, 3, text_value.c_str(), text_value.size(), SQLITE_TRANSIENT);
+                }
+                sqlite3_finalize(stmt);
+            }});
+
+        cases.push_back({"bind_name", 1000000, create_table,
+            [](sqlite::Connection & db, long n)
+            {
+                auto stmt = db.create_statement("INSERT INTO t (a, b, c) VALUES (:a, :b, :c);");
+                for(long i = 0; i < n; ++i)
+                {
+                    stmt.bind(":a", static_cast<sqlite3_int64>(i));
+                    stmt.bind(":b", i * 0.5);
+                    stmt.bind(":c", text_value);
+                }
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "INSERT INTO t (a, b, c) VALUES (:a, :b, :c);");
+                for(long i = 0; i < n; ++i)
+                {
+                    sqlite3_bind_int64(stmt, sqlite3_bind_parameter_index(stmt, ":a"), i);
+                    sqlite3_bind_double(stmt, sqlite3_bind_parameter_index(stmt, ":b"), i * 0.5);
+                    sqlite3_bind_text(stmt, sqlite3_bind_parameter_index(stmt, ":c"),
+                        text_value.c_str(), text_value.size(), SQLITE_TRANSIENT);
+                }
+                sqlite3_finalize(stmt);
+            }});
+
+        cases.push_back({"get_col_string", table_rows * 20, [](sqlite3 * db){ fill_table(db, table_rows); },
+            [](sqlite::Connection & db, long n)
+            {
+                auto stmt = db.create_statement("SELECT c FROM t;");
+                std::size_t total = 0;
+                for(long i = 0; i < n; ++i)
+                {
+                    if(!stmt.step())
+                    {
+                        stmt.reset();
+                        stmt.step();
+                    }
+                    total += stmt.get_col<std::string>(0).size();
+                }
+                if(total == 0)
+                    std::exit(EXIT_FAILURE);
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "SELECT c FROM t;");
+                std::size_t total = 0;
+                for(long i = 0; i < n; ++i)
+                {
+                    if(sqlite3_step(stmt) != SQLITE_ROW)
+                    {
+                        sqlite3_reset(stmt);
+                        sqlite3_step(stmt);
+                    }
+                    auto text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+                    total += std::string(text, sqlite3_column_bytes(stmt, 0)).size();
+                }
+                sqlite3_finalize(stmt);
+                if(total == 0)
+                    std::exit(EXIT_FAILURE);
+            }});
+
+        // row at a time reads of numeric columns, for comparison with fetch_batch
+        cases.push_back({"get_col_numeric", table_rows * 50, [](sqlite3 * db){ fill_table(db, table_rows); },
+            [](sqlite::Connection & db, long n)
+            {
+                auto stmt = db.create_statement("SELECT a, b FROM t;");
+                double total = 0.0;
+                for(long i = 0; i < n; ++i)
+                {
+                    if(!stmt.step())
+                    {
+                        stmt.reset();
+                        stmt.step();
+                    }
+                    total += stmt.get_col<sqlite3_int64>(0) + stmt.get_col<double>(1);
+                }
+                if(total == 0.0)
+                    std::exit(EXIT_FAILURE);
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "SELECT a, b FROM t;");
+                double total = 0.0;
+                for(long i = 0; i < n; ++i)
+                {
+                    if(sqlite3_step(stmt) != SQLITE_ROW)
+                    {
+                        sqlite3_reset(stmt);
+                        sqlite3_step(stmt);
+                    }
+                    total += sqlite3_column_int64(stmt, 0) + sqlite3_column_double(stmt, 1);
+                }
+                sqlite3_finalize(stmt);
+                if(total == 0.0)
+                    std::exit(EXIT_FAILURE);
+            }});
+
+        // the raw version copies into columns one row at a time, checking for NULLs as fetch() does
+        cases.push_back({"fetch_batch", table_rows * 50, [](sqlite3 * db){ fill_table(db, table_rows); },
+            [](sqlite::Connection & db, long n)
+            {
+                using Batch = sqlite::Connection::Stmt::Column_batch;
+                auto stmt = db.create_statement("SELECT a, b FROM t;");
+                Batch batch({Batch::Type::integer, Batch::Type::real});
+                double total = 0.0;
+                for(long i = 0; i < n;)
+                {
+                    auto rows = stmt.fetch(batch, std::min<long>(n - i, 4096));
+                    if(rows == 0)
+                    {
+                        stmt.reset();
+                        continue;
+                    }
+                    auto a = batch.integers(0);
+                    auto b = batch.reals(1);
+                    for(std::size_t j = 0; j < rows; ++j)
+                        total += a[j] + b[j];
+                    i += rows;
+                }
+                if(total == 0.0)
+                    std::exit(EXIT_FAILURE);
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "SELECT a, b FROM t;");
+                std::vector<sqlite3_int64> a(4096);
+                std::vector<double> b(4096);
+                std::vector<std::uint64_t> a_nulls(4096 / 64), b_nulls(4096 / 64);
+                double total = 0.0;
+                for(long i = 0; i < n;)
+                {
+                    std::fill(std::begin(a_nulls), std::end(a_nulls), 0);
+                    std::fill(std::begin(b_nulls), std::end(b_nulls), 0);
+                    long rows = 0;
+                    for(; rows < 4096 && i + rows < n; ++rows)
+                    {
+                        if(sqlite3_step(stmt) != SQLITE_ROW)
+                        {
+                            sqlite3_reset(stmt);
+                            break;
+                        }
+                        if(sqlite3_column_type(stmt, 0) == SQLITE_NULL)
+                            a_nulls[rows / 64] |= std::uint64_t{1} << (rows % 64);
+                        a[rows] = sqlite3_column_int64(stmt, 0);
+                        if(sqlite3_column_type(stmt, 1) == SQLITE_NULL)
+                            b_nulls[rows / 64] |= std::uint64_t{1} << (rows % 64);
+                        b[rows] = sqlite3_column_double(stmt, 1);
+                    }
+                    for(long j = 0; j < rows; ++j)
+                        total += a[j] + b[j];
+                    i += rows;
+                }
+                sqlite3_finalize(stmt);
+                if(total == 0.0)
+                    std::exit(EXIT_FAILURE);
+            }});
+
+        cases.push_back({"step", table_rows * 50, [](sqlite3 * db){ fill_table(db, table_rows); },
+            [](sqlite::Connection & db, long n)
+            {
+                auto stmt = db.create_statement("SELECT a, b, c FROM t;");
+                for(long i = 0; i < n; ++i)
+                {
+                    if(!stmt.step())
+                    {
+                        stmt.reset();
+                        stmt.step();
+                    }
+                }
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "SELECT a, b, c FROM t;");
+                for(long i = 0; i < n; ++i)
+                {
+                    if(sqlite3_step(stmt) != SQLITE_ROW)
+                    {
+                        sqlite3_reset(stmt);
+                        sqlite3_step(stmt);
+                    }
+                }
+                sqlite3_finalize(stmt);
+            }});
+
+        // one row per statement, in a single transaction. Bulk_inserter should beat this
+        cases.push_back({"insert_rows", 500000, create_table,
+            [](sqlite::Connection & db, long n)
+            {
+                db.begin_transaction();
+                auto stmt = db.create_statement("INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+                for(long i = 0; i < n; ++i)
+                {
+                    stmt.bind(1, static_cast<sqlite3_int64>(i));
+                    stmt.bind(2, i * 0.5);
+                    stmt.bind(3, text_value);
+                    stmt.step();
+                    stmt.reset();
+                }
+                db.commit();
+            },
+            [](sqlite3 * db, long n)
+            {
+                raw_exec(db, "BEGIN;");
+                auto stmt = raw_prepare(db, "INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+                for(long i = 0; i < n; ++i)
+                {
+                    sqlite3_bind_int64(stmt, 1, i);
+                    sqlite3_bind_double(stmt, 2, i * 0.5);
+                    sqlite3_bind_text(stmt, 3, text_value.c_str(), text_value.size(), SQLITE_TRANSIENT);
+                    check(sqlite3_step(stmt), db);
+                    sqlite3_reset(stmt);
+                }
+                sqlite3_finalize(stmt);
+                raw_exec(db, "COMMIT;");
+            }});
+
+        // the C API version does what Bulk_inserter does with its default Options
+        cases.push_back({"bulk_insert", 500000, create_table,
+            [](sqlite::Connection & db, long n)
+            {
+                sqlite::Connection::Bulk_inserter inserter(db, "t", {"a", "b", "c"});
+                for(long i = 0; i < n; ++i)
+                    inserter.insert(static_cast<sqlite3_int64>(i), i * 0.5, text_value);
+                inserter.flush();
+            },
+            [](sqlite3 * db, long n)
+            {
+                const long rows_per_statement = sqlite::Connection::Bulk_inserter::Options().rows_per_statement;
+                const long rows_per_commit = sqlite::Connection::Bulk_inserter::Options().rows_per_commit;
+
+                std::string sql = "INSERT INTO t (a, b, c) VALUES (?,?,?)";
+                for(long row = 1; row < rows_per_statement; ++row)
+                    sql += ", (?,?,?)";
+
+                auto multi_row = raw_prepare(db, sql.c_str());
+                auto single_row = raw_prepare(db, "INSERT INTO t (a, b, c) VALUES (?,?,?);");
+
+                auto write = [db](sqlite3_stmt * stmt, long first, long rows)
+                {
+                    for(long row = 0; row < rows; ++row)
+                    {
+                        auto i = first + row;
+                        sqlite3_bind_int64(stmt, row * 3 + 1, i);
+                        sqlite3_bind_double(stmt, row * 3 + 2, i * 0.5);
+                        sqlite3_bind_text(stmt, row * 3 + 3, text_value.c_str(), text_value.size(), SQLITE_STATIC);
+                    }
+                    check(sqlite3_step(stmt), db);
+                    sqlite3_reset(stmt);
+                };
+
+                raw_exec(db, "BEGIN;");
+                long since_commit = 0;
+                long i = 0;
+                for(; i + rows_per_statement <= n; i += rows_per_statement)
+                {
+                    write(multi_row, i, rows_per_statement);
+                    since_commit += rows_per_statement;
+                    if(since_commit >= rows_per_commit)
+                    {
+                        raw_exec(db, "COMMIT; BEGIN;");
+                        since_commit = 0;
+                    }
+                }
+                for(; i < n; ++i)
+                    write(single_row, i, 1);
+                raw_exec(db, "COMMIT;");
+
+                sqlite3_finalize(multi_row);
+                sqlite3_finalize(single_row);
+            }});
+
+        cases.push_back({"commit", 2000, create_table,
+            [](sqlite::Connection & db, long n)
+            {
+                auto stmt = db.create_statement("INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+                for(long i = 0; i < n; ++i)
+                {
+                    db.begin_transaction();
+                    stmt.bind(1, static_cast<sqlite3_int64>(i));
+                    stmt.bind(2, i * 0.5);
+                    stmt.bind(3, text_value);
+                    stmt.step();
+                    stmt.reset();
+                    db.commit();
+                }
+            },
+            [](sqlite3 * db, long n)
+            {
+                auto stmt = raw_prepare(db, "INSERT INTO t (a, b, c) VALUES (?, ?, ?);");
+                for(long i = 0; i < n; ++i)
+                {
+                    raw_exec(db, "BEGIN TRANSACTION;");
+                    sqlite3_bind_int64(stmt, 1, i);
+                    sqlite3_bind_double(stmt, 2, i * 0.5);
+                    sqlite3_bind_text(stmt, 3, text_value.c_str(), text_value.size(), SQLITE_TRANSIENT);
+                    check(sqlite3_step(stmt), db);
+                    sqlite3_reset(stmt);
+                    raw_exec(db, "COMMIT;");
+                }
+                sqlite3_finalize(stmt);
+            }});
+
+        return cases;
+    }
+
+    // size-class pool allocator: small blocks are carved from 64KiB slabs and recycled
+    // through per-class free lists, instead of going through malloc each time
+    class Pool_allocator final: public sqlite::Config::Allocator
+    {
+    public:
+        void * allocate(int size) noexcept override
+        {
+            auto rounded = round_up(size);
+            Header * header = nullptr;
+
+            if(rounded <= max_small)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                auto & free_list = free_[rounded / granularity - 1];
+                if(free_list)
+                {
+                    header = static_cast<Header *>(free_list);
+                    free_list = *reinterpret_cast<void **>(header + 1);
+                }
+                else
+                {
+                    auto block_size = sizeof(Header) + rounded;
+                    if(slabs_.empty() || slab_used_ + block_size > slab_size)
+                    {
+                        slabs_.emplace_back(new(std::nothrow) char[slab_size]);
+                        if(!slabs_.back())
+                            return nullptr;
+                        slab_used_ = 0;
+                    }
+                    header = reinterpret_cast<Header *>(slabs_.back().get() + slab_used_);
+                    slab_used_ += block_size;
+                }
+            }
+            else
+            {
+                header = static_cast<Header *>(std::malloc(sizeof(Header) + rounded));
+                if(!header)
+                    return nullptr;
+            }
+
+            header->size = rounded;
+            return header + 1;
+        }
+
+        void deallocate(void * ptr) noexcept override
+        {
+            if(!ptr)
+                return;
+
+            auto header = static_cast<Header *>(ptr) - 1;
+            if(header->size <= max_small)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto & free_list = free_[header->size / granularity - 1];
+                *static_cast<void **>(ptr) = free_list;
+                free_list = header;
+            }
+            else
+            {
+                std::free(header);
+            }
+        }
+
+        void * reallocate(void * ptr, int size) noexcept override
+        {
+            auto old_size = this->size(ptr);
+            if(round_up(size) == old_size)
+                return ptr;
+
+            auto new_ptr = allocate(size);
+            if(new_ptr)
+            {
+                std::memcpy(new_ptr, ptr, std::min(old_size, size));
+                deallocate(ptr);
+            }
+            return new_ptr;
+        }
+
+        int size(void * ptr) noexcept override
+        {
+            return ptr ? static_cast<int>((static_cast<Header *>(ptr) - 1)->size) : 0;
+        }
+
+        int round_up(int size) noexcept override
+        {
+            if(size <= max_small)
+                return std::max(granularity, (size + granularity - 1) / granularity * granularity);
+            else
+                return (size + 7) / 8 * 8;
+        }
+
+    private:
+        // keeps the returned memory 8-byte aligned
+        struct Header
+        {
+            std::int64_t size;
+        };
+
+        static constexpr int granularity = 64;
+        static constexpr int max_small = 1024;
+        static constexpr std::size_t slab_size = 64 * 1024;
+
+        std::mutex mutex_;
+        std::array<void *, max_small / granularity> free_{};
+        std::vector<std::unique_ptr<char[]>> slabs_;
+        std::size_t slab_used_ = 0;
+    };
+
+    struct Config
+    {
+        std::string name;
+        std::function<void()> apply;
+    };
+
+    std::vector<Config> make_configs()
+    {
+        static Pool_allocator pool_allocator;
+
+        return {
+            {"default", [](){}},
+            {"memstatus_off", [](){ sqlite::Config::set_memstatus(false); }},
+            {"lookaside_256x512", [](){ sqlite::Config::set_lookaside(256, 512); }},
+            {"page_cache_4096x2048", [](){ sqlite::Config::set_page_cache(4096, 2048); }},
+            {"pool_allocator", [](){ sqlite::Config::set_allocator(pool_allocator); }},
+            {"all", []()
+                {
+                    sqlite::Config::set_memstatus(false);
+                    sqlite::Config::set_lookaside(256, 512);
+                    sqlite::Config::set_page_cache(4096, 2048);
+                    sqlite::Config::set_allocator(pool_allocator);
+                }},
+        };
+    }
+
+    // sqlite has no way to read back its lookaside setting, so work out what it was built with
+    std::pair<int, int> default_lookaside()
+    {
+        const char * option = nullptr;
+        for(int i = 0; (option = sqlite3_compileoption_get(i)); ++i)
+        {
+            int slot_size = 0, slots = 0;
+            if(std::sscanf(option, "DEFAULT_LOOKASIDE=%d,%d", &slot_size, &slots) == 2)
+                return {slot_size, slots};
+        }
+
+        // the default became 1200x40 in 3.31.0
+        return {1200, sqlite3_libversion_number() >= 3031000 ? 40 : 100};
+    }
+
+    // put sqlite back to its default configuration
+    void reset_config()
+    {
+        static const auto lookaside = default_lookaside();
+
+        sqlite::Config::shutdown();
+        sqlite::Config::reset_allocator();
+        sqlite::Config::set_page_cache(0, 0);
+        sqlite::Config::set_memstatus(true);
+        sqlite::Config::set_lookaside(lookaside.first, lookaside.second);
+    }
+
+    void remove_db(const std::string & path)
+    {
+        for(auto suffix: {"", "-journal", "-wal", "-shm"})
+            std::remove((path + suffix).c_str());
+    }
+
+    template<typename Body>
+    double time_ns(Body && body)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    Result run(const std::string & config, const Case & test, const std::string & db_name, const std::string & path,
+        bool wrapped, long iterations)
+    {
+        if(path != ":memory:")
+            remove_db(path);
+
+        sqlite::Connection db(path);
+        test.setup(db.get_c_obj());
+
+        auto ns = time_ns([&]()
+        {
+            if(wrapped)
+                test.wrapped(db, iterations);
+            else
+                test.raw(db.get_c_obj(), iterations);
+        });
+
+        return {config, test.name, db_name, wrapped ? "sqlitepp" : "c_api", iterations, ns / iterations};
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    bool json = false;
+    bool configs = false;
+    long divisor = 1;
+    std::string filter;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg == "--json")
+            json = true;
+        else if(arg == "--quick")
+            divisor = 10;
+        else if(arg == "--configs")
+            configs = true;
+        else if(arg.compare(0, 9, "--filter=") == 0)
+            filter = arg.substr(9);
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json] [--quick] [--configs] [--filter=<substring>]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto tmpdir = std::getenv("TMPDIR");
+    auto file_path = std::string(tmpdir ? tmpdir : "/tmp") + "/sqlitepp_bench.db";
+
+    auto config_list = make_configs();
+    if(!configs)
+        config_list.resize(1);
+
+    std::vector<Result> results;
+    for(auto & config: config_list)
+    {
+        reset_config();
+        config.apply();
+
+        for(auto & test: make_cases())
+        {
+            if(!filter.empty() && test.name.find(filter) == std::string::npos)
+                continue;
+
+            auto iterations = std::max(1L, test.iterations / divisor);
+            for(auto & db: {std::make_pair("memory", ":memory:"), std::make_pair("file", file_path.c_str())})
+            {
+                for(auto wrapped: {false, true})
+                    results.push_back(run(config.name, test, db.first, db.second, wrapped, iterations));
+            }
+        }
+    }
+    remove_db(file_path);
+    reset_config();
+
+    if(json)
+    {
+        std::cout << "[\n";
+        for(std::size_t i = 0; i < results.size(); ++i)
+        {
+            auto & r = results[i];
+            std::cout << "  {\"config\": \"" << r.config << "\", \"name\": \"" << r.name << "\", \"db\": \"" << r.db << "\", \"impl\": \"" << r.impl
+                << "\", \"iterations\": " << r.iterations << ", \"ns_per_op\": " << r.ns_per_op << "}"
+                << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        std::cout << "]\n";
+    }
+    else
+    {
+        std::cout << "config,name,db,impl,iterations,ns_per_op\n";
+        for(auto & r: results)
+            std::cout << r.config << "," << r.name << "," << r.db << "," << r.impl << "," << r.iterations << "," << r.ns_per_op << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
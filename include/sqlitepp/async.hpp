@@ -0,0 +1,232 @@
+/// @file
+/// @brief Asynchronous query execution on a worker thread
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_ASYNC_HPP
+#define SQLITE_ASYNC_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// @cond INTERNAL
+    namespace detail
+    {
+        /// Return type of a function passed to Async_connection::submit
+        // std::result_of is removed in C++20, and std::invoke_result needs C++17
+        template<typename F>
+        using Submit_result = decltype(std::declval<std::decay_t<F> &>()(std::declval<Connection &>()));
+    };
+    /// @endcond
+
+    /// Connection owned by a dedicated worker thread
+
+    /// Work is queued with submit(), query() or exec(), and run in order on the
+    /// worker thread. Each call returns immediately with a \c std::future for the
+    /// result, or takes a callback to be run on the worker thread when the work completes.
+    ///
+    /// The worker runs every item queued since it last woke up before waiting again,
+    /// so consecutive submissions don't each pay for a thread hand-off.
+    ///
+    /// @code
+    /// sqlite::Async_connection db("data.db");
+    /// auto rows = db.query<int, std::string>("SELECT id, name FROM users WHERE age > ?;", 30);
+    /// // ... do other work
+    /// for(auto & row: rows.get())
+    ///     std::cout << std::get<1>(row) << "\n";
+    /// @endcode
+    class Async_connection final
+    {
+    public:
+        /// Open / create new DB
+
+        /// The DB is opened on the calling thread, so errors are reported immediately
+        /// @param[in] filename Path to sqlite database file
+        /// @param[in] statement_cache_size Statement cache capacity for query(). \c 0 to disable
+        /// @exception Runtime_error on error connecting to DB
+        explicit Async_connection(const std::string & filename, std::size_t statement_cache_size = 64);
+
+        /// Take ownership of an open connection
+
+        /// @param[in] db Connection to move to the worker thread
+        /// @param[in] statement_cache_size Statement cache capacity for query(). \c 0 to disable
+        explicit Async_connection(Connection && db, std::size_t statement_cache_size = 64);
+
+        /// Finishes all queued work, then stops the worker thread
+        ~Async_connection();
+
+        // non-copyable, non-movable (the worker thread refers to this object)
+        Async_connection(const Async_connection &) = delete;
+        Async_connection & operator=(const Async_connection &) = delete;
+
+        /// Queue a function to run on the worker thread
+
+        /// @param[in] func Function to run. Called with the worker's Connection as its only argument
+        /// @returns Future for \c func's return value. Any exception thrown by \c func is stored in the future
+        template<typename F>
+        std::future<detail::Submit_result<F>> submit(F && func);
+
+        /// Queue a function to run on the worker thread, with a completion callback
+
+        /// @param[in] func Function to run. Called with the worker's Connection as its only argument
+        /// @param[in] callback Function to call on the worker thread when \c func completes. Called
+        /// with a ready \c std::future holding \c func's result or exception. Exceptions thrown by
+        /// \c callback are discarded.
+        template<typename F, typename Callback>
+        void submit(F && func, Callback && callback);
+
+        /// Queue a SELECT and collect all of its rows
+
+        /// The statement is taken from the worker's statement cache, bound with
+        /// Connection::Stmt::bind_all, and each row retrieved with Connection::Stmt::get_row
+        /// @param[in] sql SQL code to run
+        /// @param[in] args Bind variable values. Copied for use on the worker thread -
+        /// C strings and Text_view are copied into \c std::string, and Blob_view into \c std::vector
+        /// @returns Future for the rows. Column types must own their data
+        /// (ie. \c std::string, not Text_view). Any exception is stored in the future
+        template<typename... Ts, typename... Args>
+        std::future<std::vector<std::tuple<Ts...>>> query(const std::string & sql, Args &&... args);
+
+        /// Queue SQL statement(s) to execute
+
+        /// @param[in] sql SQL code to execute
+        /// @returns Future to wait on. Any exception is stored in the future
+        std::future<void> exec(const std::string & sql);
+
+    private:
+        /// Queued work item
+        using Work = std::function<void(Connection &)>;
+
+        /// Add an item to the work queue
+        void post(Work work);
+
+        /// Worker thread main loop
+        void run();
+
+        /// Bind copied query() args
+        template<typename Tuple, std::size_t... Indexes>
+        static void bind_all(Connection::Stmt & stmt, const Tuple & args, std::index_sequence<Indexes...>);
+
+        Connection db_; ///< Connection, only used from the worker thread
+        std::mutex mutex_; ///< Guards queue_ and stopping_
+        std::condition_variable wake_; ///< Signalled when work is queued or stopping
+        std::vector<Work> queue_; ///< Pending work
+        bool stopping_ = false; ///< Set to stop the worker
+        std::thread worker_; ///< Worker thread
+    };
+
+    /// @cond INTERNAL
+    namespace detail
+    {
+        /// Copy a value so it can be used after the caller's data goes away
+        template<typename T>
+        std::decay_t<T> to_owned(T && val)
+        {
+            return std::forward<T>(val);
+        }
+
+        inline std::string to_owned(const char * val)
+        {
+            return val ? std::string(val) : std::string();
+        }
+
+        inline std::string to_owned(char * val)
+        {
+            return to_owned(static_cast<const char *>(val));
+        }
+
+        inline std::string to_owned(const Text_view val)
+        {
+            return val.str();
+        }
+
+        inline std::vector<unsigned char> to_owned(const Blob_view val)
+        {
+            return std::vector<unsigned char>(val.begin(), val.end());
+        }
+    };
+    /// @endcond
+
+    template<typename F>
+    std::future<detail::Submit_result<F>> Async_connection::submit(F && func)
+    {
+        using Result = detail::Submit_result<F>;
+
+        // std::function requires copyable targets, and packaged_task is move-only
+        auto task = std::make_shared<std::packaged_task<Result(Connection &)>>(std::forward<F>(func));
+        auto result = task->get_future();
+        post([task](Connection & db){ (*task)(db); });
+
+        return result;
+    }
+
+    template<typename F, typename Callback>
+    void Async_connection::submit(F && func, Callback && callback)
+    {
+        using Result = detail::Submit_result<F>;
+
+        auto task = std::make_shared<std::packaged_task<Result(Connection &)>>(std::forward<F>(func));
+        auto on_complete = std::make_shared<std::decay_t<Callback>>(std::forward<Callback>(callback));
+        post([task, on_complete](Connection & db)
+        {
+            (*task)(db);
+            (*on_complete)(task->get_future());
+        });
+    }
+
+    template<typename... Ts, typename... Args>
+    std::future<std::vector<std::tuple<Ts...>>> Async_connection::query(const std::string & sql, Args &&... args)
+    {
+        return submit([sql, args = std::make_tuple(detail::to_owned(std::forward<Args>(args))...)](Connection & db)
+        {
+            auto stmt = db.cached_statement(sql);
+            bind_all(*stmt, args, std::index_sequence_for<Args...>{});
+
+            std::vector<std::tuple<Ts...>> rows;
+            while(stmt->step())
+                rows.push_back(stmt->get_row<Ts...>());
+
+            return rows;
+        });
+    }
+
+    template<typename Tuple, std::size_t... Indexes>
+    void Async_connection::bind_all(Connection::Stmt & stmt, const Tuple & args, std::index_sequence<Indexes...>)
+    {
+        stmt.bind_all(std::get<Indexes>(args)...);
+    }
+};
+
+# endif // SQLITE_ASYNC_HPP
@@ -0,0 +1,149 @@
+/// @file
+/// @brief Online backup between database connections
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_BACKUP_HPP
+#define SQLITE_BACKUP_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Online backup of a database to another connection
+
+    /// Copies a database a few pages at a time, so that other connections can
+    /// keep reading and writing the source between steps. If the source is
+    /// written by a different connection, the backup starts over on the next
+    /// step. Writes made through the source connection itself are copied
+    /// to the destination as they happen.
+    ///
+    /// @code
+    /// sqlite::Connection dest("backup.db");
+    /// sqlite::Backup backup(dest, db);
+    /// backup.run(options, [](int remaining, int total){ std::cout << total - remaining << "/" << total << "\n"; return true; });
+    /// @endcode
+    /// @note Neither connection may be used by other threads while a step runs, unless opened with \c SQLITE_OPEN_FULLMUTEX
+    /// @sa [C API](https://www.sqlite.org/c3ref/backup_finish.html)
+    class Backup final
+    {
+    public:
+        /// Backup settings for run()
+        struct Options
+        {
+            int pages_per_step = 100; ///< Pages to copy in each step. \c -1 to copy everything in one step
+            std::chrono::milliseconds sleep{10}; ///< Time to wait between steps, letting other connections lock the source. \c 0 to only yield
+        };
+
+        /// Progress callback for run()
+
+        /// Called after every step, with the number of pages left to copy, and the total number of pages.
+        /// Return \c false to cancel the backup
+        using Progress = std::function<bool(int remaining, int page_count)>;
+
+        /// Start a backup
+
+        /// @param[in] dest Connection to copy to. Its existing contents will be replaced
+        /// @param[in] source Connection to copy from
+        /// @param[in] dest_name DB name to copy to, or \c "main" if omitted
+        /// @param[in] source_name DB name to copy from, or \c "main" if omitted
+        /// @exception Runtime_error on error starting the backup, such as a read transaction open on \c dest
+        /// @note Both connections must outlive this object
+        /// @sa [C API](https://www.sqlite.org/c3ref/backup_finish.html#sqlite3backupinit)
+        Backup(Connection & dest, Connection & source,
+            const std::string & dest_name = "main", const std::string & source_name = "main");
+
+        /// Finish the backup. Errors are ignored - call finish() first to detect them
+        ~Backup();
+
+        // non-copyable
+        Backup(const Backup &) = delete;
+        Backup & operator=(const Backup &) = delete;
+
+        // movable
+        Backup(Backup &&);
+        Backup & operator=(Backup &&);
+
+        /// Copy pages
+
+        /// @param[in] pages Number of pages to copy. \c -1 to copy all remaining pages
+        /// @returns \c true if the backup is complete, \c false if there are pages left to
+        /// copy, or the source or destination was locked by another connection
+        /// @exception Runtime_error on error copying
+        /// @sa [C API](https://www.sqlite.org/c3ref/backup_finish.html#sqlite3backupstep)
+        bool step(int pages = -1);
+
+        /// Copy all pages, a few at a time
+
+        /// Calls step() repeatedly, sleeping between steps, until the backup is
+        /// complete or cancelled
+        /// @param[in] options Backup settings
+        /// @param[in] progress Called after every step. May be empty
+        /// @returns \c true if the backup completed, \c false if it was cancelled
+        /// @exception Runtime_error on error copying
+        bool run(const Options & options, const Progress & progress = nullptr);
+
+        /// @copybrief run(const Options &, const Progress &)
+
+        /// Uses default Options
+        /// @returns \c true if the backup completed, \c false if it was cancelled
+        /// @exception Runtime_error on error copying
+        bool run();
+
+        /// Cancel run()
+
+        /// May be called from any thread. run() returns \c false after the current step
+        void cancel();
+
+        /// Get number of pages left to copy
+
+        /// @returns Pages left to copy, as of the last step
+        /// @sa [C API](https://www.sqlite.org/c3ref/backup_finish.html#sqlite3backupremaining)
+        int remaining() const;
+
+        /// Get total number of pages in the source
+
+        /// @returns Pages in the source DB, as of the last step
+        /// @sa [C API](https://www.sqlite.org/c3ref/backup_finish.html#sqlite3backuppagecount)
+        int page_count() const;
+
+        /// Release the backup's resources
+
+        /// The destination is left in its current state, which is only a complete
+        /// copy if step() or run() reported completion. No other functions may be called afterwards
+        /// @exception Runtime_error if the last step failed
+        /// @sa [C API](https://www.sqlite.org/c3ref/backup_finish.html#sqlite3backupfinish)
+        void finish();
+
+    private:
+        sqlite3_backup * backup_ = nullptr; ///< sqlite C API's backup obj
+        sqlite3 * dest_ = nullptr; ///< (non-owned) Destination connection, for error reporting
+        std::atomic<bool> cancelled_{false}; ///< Set by cancel()
+    };
+};
+
+# endif // SQLITE_BACKUP_HPP
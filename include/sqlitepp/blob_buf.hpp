@@ -0,0 +1,85 @@
+/// @file
+/// @brief std::streambuf adapter for incremental BLOB I/O
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_BLOB_BUF_HPP
+#define SQLITE_BLOB_BUF_HPP
+
+#include <streambuf>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Stream buffer for reading and writing a BLOB in fixed-size chunks
+
+    /// Wraps a Connection::Blob so that it can be used with \c std::istream and
+    /// \c std::ostream. Data is transferred to and from sqlite one chunk at a time,
+    /// so the whole BLOB is never held in memory.
+    ///
+    /// BLOBs can't be resized, so writing past the end of the BLOB will fail.
+    /// Seeking is supported, with the get and put positions tied together.
+    ///
+    /// @code
+    /// auto blob = db.open_blob("files", "data", rowid);
+    /// sqlite::Blob_buf buf(blob);
+    /// std::istream in(&buf);
+    /// @endcode
+    class Blob_buf final: public std::streambuf
+    {
+    public:
+        /// @param[in] blob (non-owning) BLOB to read from / write to. Must outlive this object
+        /// @param[in] chunk_size Size of the internal buffer, in bytes
+        explicit Blob_buf(Connection::Blob & blob, std::size_t chunk_size = 64 * 1024);
+
+        /// Writes any buffered data. Errors are ignored - call \c pubsync() first to detect them
+        ~Blob_buf();
+
+        // non-copyable
+        Blob_buf(const Blob_buf &) = delete;
+        Blob_buf & operator=(const Blob_buf &) = delete;
+
+    protected:
+        int_type underflow() override;
+        int_type overflow(int_type ch) override;
+        int sync() override;
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+            std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override;
+        pos_type seekpos(pos_type pos,
+            std::ios_base::openmode which = std::ios_base::in | std::ios_base::out) override;
+
+    private:
+        /// Get current read / write position in the BLOB
+        std::size_t position() const;
+
+        /// Write the put area to the BLOB, and empty the get and put areas
+        void flush();
+
+        Connection::Blob & blob_; ///< (non-owned) BLOB handle
+        std::vector<char> buffer_; ///< Chunk buffer, used for either reading or writing
+        std::size_t buffer_offset_ = 0; ///< BLOB offset corresponding to the start of buffer_
+    };
+};
+
+# endif // SQLITE_BLOB_BUF_HPP
@@ -0,0 +1,242 @@
+/// @file
+/// @brief High-throughput bulk INSERTs
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_BULK_INSERT_HPP
+#define SQLITE_BULK_INSERT_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Bulk loader for INSERTing large numbers of rows into a table
+
+    /// Rows are buffered and written with multi-row <tt>INSERT ... VALUES (...),(...)</tt>
+    /// statements, sized to fit sqlite's bind variable limit. Prepared statements are
+    /// reused for every chunk. Rows are written inside transactions, which are committed
+    /// periodically, based on the number of rows or bytes written.
+    ///
+    /// If a transaction is already open on the Connection when rows are inserted, the
+    /// caller remains responsible for committing it, and no automatic commits are made.
+    ///
+    /// @code
+    /// sqlite::Connection::Bulk_inserter loader(db, "points", {"x", "y", "label"});
+    /// for(auto & p: points)
+    ///     loader.insert(p.x, p.y, p.label);
+    /// loader.flush();
+    /// @endcode
+    class Connection::Bulk_inserter final
+    {
+    public:
+        /// Bulk_inserter settings
+        struct Options
+        {
+            /// Commit after at least this many rows have been written. \c 0 to only commit on flush()
+            std::size_t rows_per_commit = 100000;
+            /// Commit after at least this many bytes of data have been written. \c 0 for no limit
+            std::size_t bytes_per_commit = 0;
+            /// Max rows per INSERT statement. Limited by sqlite's bind variable limit. Past a few dozen rows,
+            /// larger statements cost more to prepare and bind than they save in per-statement overhead
+            std::size_t rows_per_statement = 32;
+        };
+
+        /// Bulk_inserter counters
+
+        /// This is the return type for stats()
+        struct Stats
+        {
+            std::uint64_t rows = 0; ///< Number of rows written to the DB
+            std::uint64_t statements = 0; ///< Number of INSERT statements executed
+            std::uint64_t commits = 0; ///< Number of transactions committed
+            std::chrono::duration<double> elapsed{}; ///< Time since the first row was inserted
+
+            /// Get insertion rate
+
+            /// @returns Rows written per second, or \c 0 if no time has elapsed
+            double rows_per_second() const;
+        };
+
+        /// @param[in] db Database Connection to insert into. Must outlive this object
+        /// @param[in] table Table name. Used verbatim in the generated SQL, and may be schema-qualified
+        /// @param[in] columns Names of columns to insert into, in the order values are passed to insert().
+        /// Used verbatim in the generated SQL
+        /// @param[in] options Chunking and commit settings
+        /// @exception Logic_error if there are no columns, or more columns than bind variables allowed,
+        /// or on error parsing the generated SQL
+        Bulk_inserter(Connection & db, const std::string & table, const std::vector<std::string> & columns,
+            const Options & options);
+
+        /// @copybrief Bulk_inserter(Connection &, const std::string &, const std::vector<std::string> &, const Options &)
+
+        /// Uses default Options
+        /// @param[in] db Database Connection to insert into. Must outlive this object
+        /// @param[in] table Table name. Used verbatim in the generated SQL, and may be schema-qualified
+        /// @param[in] columns Names of columns to insert into, in the order values are passed to insert().
+        /// Used verbatim in the generated SQL
+        /// @exception Logic_error if there are no columns, or more columns than bind variables allowed,
+        /// or on error parsing the generated SQL
+        Bulk_inserter(Connection & db, const std::string & table, const std::vector<std::string> & columns);
+
+        /// Rolls back any rows not yet committed. Call flush() first to keep them
+        ~Bulk_inserter();
+
+        // non-copyable, non-movable
+        Bulk_inserter(const Bulk_inserter &) = delete;
+        Bulk_inserter & operator=(const Bulk_inserter &) = delete;
+
+        /// Insert a row
+
+        /// The row may be buffered until enough rows have been inserted to fill an INSERT statement.
+        /// Values are converted as for Connection::Stmt::bind_all. Text and blob values
+        /// are copied into an internal buffer, which is reused between statements.
+        /// @param[in] values Column values, in the order of the \c columns passed to the constructor
+        /// @exception Logic_error if the number of values doesn't match the number of columns,
+        /// or on error binding or evaluating SQL. On error writing rows, all rows buffered
+        /// but not yet written are discarded, and the inserter may be used again
+        template<typename... Args>
+        void insert(Args &&... values);
+
+        /// Write all buffered rows and commit
+
+        /// @exception Logic_error on error evaluating SQL. On error writing rows, all rows
+        /// buffered but not yet written are discarded, and the inserter may be used again
+        void flush();
+
+        /// Get counters
+        Stats stats() const;
+
+    private:
+        /// Buffered column value
+        struct Value
+        {
+            /// Value's sqlite storage class
+            enum class Type {null, integer, real, text, blob};
+
+            Type type = Type::null; ///< storage class
+            sqlite3_int64 integer = 0; ///< value for Type::integer
+            double real = 0.0; ///< value for Type::real
+            std::string bytes; ///< value for Type::text and Type::blob
+        };
+
+        /// Throw Logic_error if \c count doesn't match the number of columns
+        void check_column_count(std::size_t count) const;
+
+        /// Begin a transaction if needed and start the rate timer
+        void begin_row();
+
+        /// Write the row if it completes a chunk, and commit if needed
+        void end_row();
+
+        /// @name Buffer value functions
+        /// Store a value to be bound later
+        /// @{
+        void store(const int val);
+        void store(const sqlite3_int64 val);
+        void store(const double val);
+        void store(const Text_view val);
+        void store(const Blob_view val);
+        void store(std::nullptr_t);
+        /// @}
+
+        /// Convert and store a value for insert()
+        template<typename T>
+        void store_value(T && val);
+
+        /// Write buffered rows to the DB
+
+        /// A full chunk is written with a single statement. Fewer rows are written one at a time,
+        /// so that only two statements are ever prepared
+        void write_rows(std::size_t rows);
+
+        /// Bind buffered rows, starting at \c first_row, and step the statement
+        void write_statement(Stmt & stmt, std::size_t first_row, std::size_t rows);
+
+        /// Discard buffered rows
+        void clear_pending();
+
+        /// Get (or prepare) the INSERT statement for the given number of rows
+        Stmt & statement(std::size_t rows);
+
+        /// Commit the current transaction, if we started it
+        void commit();
+
+        Connection & db_; ///< DB to insert into
+        std::string sql_prefix_; ///< INSERT statement up to the VALUES
+        std::string sql_row_; ///< Bind vars for a single row of VALUES
+        std::size_t columns_; ///< Number of columns per row
+        std::size_t rows_per_statement_; ///< Number of rows per full INSERT statement
+        Options options_; ///< Commit settings
+
+        std::vector<Value> values_; ///< Buffered rows. Reused between chunks to avoid reallocation
+        std::size_t next_value_ = 0; ///< Index into values_ for next value
+        std::size_t pending_rows_ = 0; ///< Number of complete rows in values_
+
+        std::unordered_map<std::size_t, Stmt> statements_; ///< Prepared INSERT statements, by row count. Only full chunks and single rows
+
+        bool own_transaction_ = false; ///< \c true when we have a transaction open
+        std::size_t rows_since_commit_ = 0; ///< Rows written in current transaction
+        std::size_t bytes_since_commit_ = 0; ///< Bytes written in current transaction
+        std::size_t pending_bytes_ = 0; ///< Bytes buffered in values_
+
+        Stats stats_; ///< Counters
+        std::chrono::steady_clock::time_point start_; ///< Time the first row was inserted
+    };
+
+    template<typename... Args>
+    void Connection::Bulk_inserter::insert(Args &&... values)
+    {
+        check_column_count(sizeof...(Args));
+        begin_row();
+        auto row_start_bytes = pending_bytes_;
+
+        try
+        {
+            // braced init list guarantees left-to-right evaluation
+            int expand[] = {0, (store_value(std::forward<Args>(values)), 0)...};
+            static_cast<void>(expand);
+        }
+        catch(...)
+        {
+            // discard the partial row
+            next_value_ = pending_rows_ * columns_;
+            pending_bytes_ = row_start_bytes;
+            throw;
+        }
+
+        end_row();
+    }
+
+    template<typename T>
+    void Connection::Bulk_inserter::store_value(T && val)
+    {
+        store(static_cast<typename detail::Bind_as<std::decay_t<T>>::type>(val));
+    }
+};
+
+# endif // SQLITE_BULK_INSERT_HPP
@@ -0,0 +1,166 @@
+/// @file
+/// @brief Process-wide sqlite configuration: memory allocator, page cache, and lookaside
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_CONFIG_HPP
+#define SQLITE_CONFIG_HPP
+
+#include <sqlitepp/sqlite3.h>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Process-wide sqlite configuration (Static class)
+
+    /// sqlite only accepts these settings before it is initialized, which happens
+    /// when the first Connection is opened, or after shutdown(). Configure at the
+    /// start of the program, before any other thread may open a connection. Setting
+    /// anything after initialization throws Logic_error with \c SQLITE_MISUSE.
+    /// @sa [C API](https://www.sqlite.org/c3ref/config.html)
+    class Config final
+    {
+    public:
+        // make noncreatable
+        Config() = delete;
+        ~Config() = delete;
+
+        /// Memory allocator interface
+
+        /// Implement this to supply sqlite's memory, from an arena or pool allocator for example.
+        /// All allocations must be aligned to at least 8 bytes.
+        /// Functions must be thread-safe unless sqlite is single-threaded,
+        /// and must not throw.
+        /// @sa [C API](https://www.sqlite.org/c3ref/mem_methods.html)
+        class Allocator
+        {
+        public:
+            virtual ~Allocator() = default;
+
+            /// Allocate memory
+
+            /// @param[in] size Number of bytes to allocate
+            /// @returns Allocated memory, or \c nullptr on failure
+            virtual void * allocate(int size) noexcept = 0;
+
+            /// Free memory
+
+            /// @param[in] ptr Memory from allocate() or reallocate()
+            virtual void deallocate(void * ptr) noexcept = 0;
+
+            /// Resize memory
+
+            /// @param[in] ptr Memory from allocate() or reallocate()
+            /// @param[in] size New size, in bytes
+            /// @returns Resized memory, or \c nullptr on failure, in which case \c ptr remains valid
+            virtual void * reallocate(void * ptr, int size) noexcept = 0;
+
+            /// Get allocation size
+
+            /// @param[in] ptr Memory from allocate() or reallocate()
+            /// @returns Size of the allocation, in bytes
+            virtual int size(void * ptr) noexcept = 0;
+
+            /// Round up an allocation size
+
+            /// @param[in] size Requested size, in bytes
+            /// @returns Size allocate() would actually provide for \c size
+            virtual int round_up(int size) noexcept { return size; }
+        };
+
+        /// Use a custom memory allocator for all of sqlite's memory
+
+        /// @param[in] allocator (non-owning) Allocator. Must remain valid until after shutdown()
+        /// @exception Logic_error if sqlite is already initialized
+        /// @sa [C API](https://www.sqlite.org/c3ref/c_config_covering_index_scan.html#sqliteconfigmalloc)
+        static void set_allocator(Allocator & allocator);
+
+        /// Go back to sqlite's default memory allocator
+
+        /// @exception Logic_error if sqlite is already initialized
+        static void reset_allocator();
+
+        /// Give sqlite preallocated memory for its page cache
+
+        /// Page cache memory is allocated as one block, instead of a separate
+        /// allocation for each page. Pages that don't fit fall back to the general allocator.
+        /// @param[in] page_size Largest DB page size that will be used, in bytes
+        /// @param[in] pages Number of pages to preallocate. \c 0 to stop using a preallocated page cache
+        /// @exception Logic_error if sqlite is already initialized
+        /// @sa [C API](https://www.sqlite.org/c3ref/c_config_covering_index_scan.html#sqliteconfigpagecache)
+        static void set_page_cache(int page_size, int pages);
+
+        /// Enable or disable memory usage tracking
+
+        /// Tracking is on by default. Turning it off avoids a mutex and bookkeeping on every
+        /// allocation, but memory_used() and memory_highwater() will no longer work, and
+        /// \c sqlite3_soft_heap_limit64 will have no effect
+        /// @param[in] enable \c true to track memory usage
+        /// @exception Logic_error if sqlite is already initialized
+        /// @sa [C API](https://www.sqlite.org/c3ref/c_config_covering_index_scan.html#sqliteconfigmemstatus)
+        static void set_memstatus(bool enable);
+
+        /// Set default lookaside memory for new connections
+
+        /// Lookaside is a per-connection pool of small, fixed-size allocations.
+        /// Can be overridden for each connection with Connection::Open_options
+        /// @param[in] slot_size Size of each slot, in bytes
+        /// @param[in] slots Number of slots. \c 0 to disable lookaside
+        /// @exception Logic_error if sqlite is already initialized
+        /// @sa [C API](https://www.sqlite.org/c3ref/c_config_covering_index_scan.html#sqliteconfiglookaside)
+        static void set_lookaside(int slot_size, int slots);
+
+        /// Initialize sqlite
+
+        /// Called automatically when the first Connection is opened.
+        /// Settings can no longer be changed after this
+        /// @exception Runtime_error on error
+        /// @sa [C API](https://www.sqlite.org/c3ref/initialize.html)
+        static void initialize();
+
+        /// Shut down sqlite
+
+        /// Releases all of sqlite's resources, so that settings can be changed.
+        /// @warning All Connection objects must be closed first, and no other thread may be using sqlite
+        /// @exception Runtime_error on error
+        /// @sa [C API](https://www.sqlite.org/c3ref/initialize.html)
+        static void shutdown();
+
+        /// Get memory currently in use by sqlite
+
+        /// @returns Bytes of memory currently allocated. Always \c 0 when memstatus is disabled
+        /// @sa [C API](https://www.sqlite.org/c3ref/memory_highwater.html)
+        static sqlite3_int64 memory_used();
+
+        /// Get maximum memory used by sqlite
+
+        /// @param[in] reset \c true to reset the high-water mark to the current usage
+        /// @returns Most bytes of memory allocated at once. Always \c 0 when memstatus is disabled
+        /// @sa [C API](https://www.sqlite.org/c3ref/memory_highwater.html)
+        static sqlite3_int64 memory_highwater(bool reset = false);
+
+    private:
+        /// Throw Logic_error for a failed sqlite3_config call
+        [[noreturn]] static void throw_config_error(const char * what, int status);
+    };
+};
+
+# endif // SQLITE_CONFIG_HPP
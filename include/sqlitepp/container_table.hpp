@@ -0,0 +1,540 @@
+/// @file
+/// @brief Read-only virtual table over a C++ container
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_CONTAINER_TABLE_HPP
+#define SQLITE_CONTAINER_TABLE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sqlitepp/error.hpp>
+#include <sqlitepp/function.hpp>
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Read-only virtual table over a random-access container of structs
+
+    /// Describes how to expose a container's elements as rows, with struct members as
+    /// columns. Register it with Connection::create_container_table(). The container is
+    /// not copied - rows are read directly from it while a query runs.
+    ///
+    /// The rowid of each row is its index in the container. Queries with
+    /// <tt>rowid = ?</tt>, or <tt>key = ?</tt> on the column set with key_column(),
+    /// look rows up directly instead of scanning the whole container.
+    ///
+    /// Supported member types are \c bool, integral and floating point types, \c std::string,
+    /// and <tt>std::vector<unsigned char></tt> (as a BLOB).
+    /// @tparam Container Container type, such as \c std::vector or \c std::deque
+    /// @note The container must outlive the connection, or until the table is replaced,
+    /// and must not be modified while a statement using the table is running
+    /// @sa [Virtual tables](https://www.sqlite.org/vtab.html)
+    template<typename Container>
+    class Container_table final
+    {
+    public:
+        /// Container element type
+        using value_type = typename Container::value_type;
+
+        /// @param[in] data (non-owning) Container to expose
+        explicit Container_table(const Container & data);
+
+        /// Add a column
+
+        /// @param[in] name Column name
+        /// @param[in] member Pointer to the member of \c value_type to read the column from
+        /// @returns \c *this, to allow chaining
+        template<typename M>
+        Container_table & column(const std::string & name, M value_type::* member);
+
+        /// Add the key column
+
+        /// Equality constraints on the key column are found by binary search, so
+        /// the container must be sorted by this column, in ascending order.
+        /// There may only be one key column
+        /// @param[in] name Column name
+        /// @param[in] member Pointer to the member of \c value_type to read the column from
+        /// @returns \c *this, to allow chaining
+        template<typename M>
+        Container_table & key_column(const std::string & name, M value_type::* member);
+
+    private:
+        friend class Connection;
+
+        /// Column description
+        struct Column
+        {
+            std::string name; ///< Column name
+            const char * type; ///< Declared SQL type
+            std::function<void(sqlite3_context *, const value_type &)> get; ///< Set the column's value as a function result
+        };
+
+        /// Virtual table instance
+        struct Vtab: sqlite3_vtab
+        {
+            const Container_table * table; ///< Table description
+        };
+
+        /// Cursor over a range of rows
+        struct Cursor: sqlite3_vtab_cursor
+        {
+            std::size_t pos = 0; ///< Current row
+            std::size_t end = 0; ///< One past the last row
+        };
+
+        /// Compare rows to a key, by the key column
+        template<typename M>
+        struct Key_less
+        {
+            M value_type::* member; ///< Key column member
+
+            bool operator()(const value_type & row, const M & key) const { return row.*member < key; }
+            bool operator()(const M & key, const value_type & row) const { return key < row.*member; }
+        };
+
+        /// Query plans chosen by best_index()
+        enum Plan: int {full_scan, key_lookup, rowid_lookup};
+
+        /// Get the sqlite module, with all of the callbacks below
+        static const sqlite3_module * module();
+
+        /// @name Virtual table callbacks
+        /// @{
+        static int connect(sqlite3 * db, void * aux, int argc, const char * const * argv, sqlite3_vtab ** vtab, char ** err);
+        static int disconnect(sqlite3_vtab * vtab);
+        static int best_index(sqlite3_vtab * vtab, sqlite3_index_info * info);
+        static int open(sqlite3_vtab * vtab, sqlite3_vtab_cursor ** cursor);
+        static int close(sqlite3_vtab_cursor * cursor);
+        static int filter(sqlite3_vtab_cursor * cursor, int plan, const char *, int argc, sqlite3_value ** argv);
+        static int next(sqlite3_vtab_cursor * cursor);
+        static int eof(sqlite3_vtab_cursor * cursor);
+        static int column_value(sqlite3_vtab_cursor * cursor, sqlite3_context * context, int column);
+        static int rowid(sqlite3_vtab_cursor * cursor, sqlite3_int64 * rowid);
+        /// @}
+
+        /// Convert a value to an integer, if it has one exactly (as \c 1 or \c 1.0, but not \c 1.5 or \c 'abc')
+
+        /// @returns \c false if the value isn't an exact integer
+        static bool integral_value(sqlite3_value * value, sqlite3_int64 & integer);
+
+        /// Convert a constraint value to a key
+
+        /// @returns \c false if no key of type \c M can equal the value, such as for NULL
+        /// @{
+        template<typename M>
+        static bool key_value(sqlite3_value * value, M & key, std::true_type /*integral*/, std::false_type);
+        template<typename M>
+        static bool key_value(sqlite3_value * value, M & key, std::false_type, std::true_type /*floating point*/);
+        template<typename M>
+        static bool key_value(sqlite3_value * value, M & key, std::false_type, std::false_type);
+        /// @}
+
+        /// Declared SQL type for a member type
+        template<typename M>
+        static const char * sql_type();
+
+        /// Set a column value as a function result, without copying
+        /// @{
+        static void set_column(sqlite3_context * context, const std::string & val);
+        static void set_column(sqlite3_context * context, const std::vector<unsigned char> & val);
+        template<typename M>
+        static void set_column(sqlite3_context * context, const M & val);
+        /// @}
+
+        const Container * data_ = nullptr; ///< (non-owned) Container to expose
+        std::vector<Column> columns_; ///< Table columns
+        int key_column_ = -1; ///< Index of key column, or \c -1 for none
+
+        /// Find rows whose key column equals \c value. Set by key_column()
+        std::function<std::pair<std::size_t, std::size_t>(const Container &, sqlite3_value *)> key_range_;
+    };
+
+    template<typename Container>
+    Container_table<Container>::Container_table(const Container & data): data_(&data)
+    {
+    }
+
+    template<typename Container>
+    template<typename M>
+    Container_table<Container> & Container_table<Container>::column(const std::string & name, M value_type::* member)
+    {
+        columns_.push_back({name, sql_type<M>(),
+            [member](sqlite3_context * context, const value_type & row){ set_column(context, row.*member); }});
+        return *this;
+    }
+
+    template<typename Container>
+    template<typename M>
+    Container_table<Container> & Container_table<Container>::key_column(const std::string & name, M value_type::* member)
+    {
+        if(key_column_ >= 0)
+            throw Logic_error("Container_table " + name + ": key column already set", "", SQLITE_MISUSE, nullptr);
+
+        key_column_ = static_cast<int>(columns_.size());
+        column(name, member);
+
+        key_range_ = [member](const Container & data, sqlite3_value * value)
+        {
+            M key{};
+            if(!key_value(value, key, std::is_integral<M>{}, std::is_floating_point<M>{}))
+                return std::make_pair(std::size_t{0}, std::size_t{0});
+
+            auto range = std::equal_range(std::begin(data), std::end(data), key, Key_less<M>{member});
+            return std::make_pair(static_cast<std::size_t>(std::distance(std::begin(data), range.first)),
+                static_cast<std::size_t>(std::distance(std::begin(data), range.second)));
+        };
+
+        return *this;
+    }
+
+    template<typename Container>
+    const sqlite3_module * Container_table<Container>::module()
+    {
+        // no xCreate, so the table is eponymous-only: it's used by the module's name, without CREATE VIRTUAL TABLE
+        static const sqlite3_module module = []()
+        {
+            sqlite3_module module{};
+            module.xConnect = connect;
+            module.xBestIndex = best_index;
+            module.xDisconnect = disconnect;
+            module.xDestroy = disconnect;
+            module.xOpen = open;
+            module.xClose = close;
+            module.xFilter = filter;
+            module.xNext = next;
+            module.xEof = eof;
+            module.xColumn = column_value;
+            module.xRowid = rowid;
+            return module;
+        }();
+        return &module;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::connect(sqlite3 * db, void * aux, int, const char * const *,
+        sqlite3_vtab ** vtab, char ** err)
+    {
+        auto table = static_cast<const Container_table *>(aux);
+        try
+        {
+            std::string schema = "CREATE TABLE x(";
+            for(std::size_t i = 0; i < table->columns_.size(); ++i)
+            {
+                std::string name;
+                for(auto c: table->columns_[i].name)
+                    name += (c == '"') ? "\"\"" : std::string(1, c);
+                schema += (i ? ", \"" : "\"") + name + "\" " + table->columns_[i].type;
+            }
+            schema += ");";
+
+            int status = sqlite3_declare_vtab(db, schema.c_str());
+            if(status != SQLITE_OK)
+            {
+                *err = sqlite3_mprintf("%s", sqlite3_errmsg(db));
+                return status;
+            }
+
+            auto new_vtab = new Vtab{};
+            new_vtab->table = table;
+            *vtab = new_vtab;
+            return SQLITE_OK;
+        }
+        catch(...)
+        {
+            return SQLITE_NOMEM;
+        }
+    }
+
+    template<typename Container>
+    int Container_table<Container>::disconnect(sqlite3_vtab * vtab)
+    {
+        delete static_cast<Vtab *>(vtab);
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::best_index(sqlite3_vtab * vtab, sqlite3_index_info * info)
+    {
+        auto & table = *static_cast<Vtab *>(vtab)->table;
+        auto size = static_cast<double>(table.data_->size());
+
+        info->idxNum = full_scan;
+        info->estimatedCost = size;
+        info->estimatedRows = static_cast<sqlite3_int64>(size);
+
+        for(int i = 0; i < info->nConstraint; ++i)
+        {
+            auto & constraint = info->aConstraint[i];
+            if(!constraint.usable || constraint.op != SQLITE_INDEX_CONSTRAINT_EQ)
+                continue;
+
+            if(constraint.iColumn == -1)
+            {
+                // a rowid lookup beats anything else
+                info->idxNum = rowid_lookup;
+                info->estimatedCost = 1.0;
+                info->estimatedRows = 1;
+                info->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+                for(int j = 0; j < info->nConstraint; ++j)
+                    info->aConstraintUsage[j].argvIndex = 0;
+                info->aConstraintUsage[i].argvIndex = 1;
+                info->aConstraintUsage[i].omit = 1;
+                break;
+            }
+            else if(constraint.iColumn == table.key_column_ && info->idxNum == full_scan)
+            {
+                // sqlite rechecks the constraint, as its comparison rules may differ from the key type's
+                info->idxNum = key_lookup;
+                info->estimatedCost = std::log2(size + 1.0) + 1.0;
+                info->estimatedRows = 1;
+                info->aConstraintUsage[i].argvIndex = 1;
+                info->aConstraintUsage[i].omit = 0;
+            }
+        }
+
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::open(sqlite3_vtab *, sqlite3_vtab_cursor ** cursor)
+    {
+        try
+        {
+            *cursor = new Cursor{};
+            return SQLITE_OK;
+        }
+        catch(...)
+        {
+            return SQLITE_NOMEM;
+        }
+    }
+
+    template<typename Container>
+    int Container_table<Container>::close(sqlite3_vtab_cursor * cursor)
+    {
+        delete static_cast<Cursor *>(cursor);
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::filter(sqlite3_vtab_cursor * cursor_base, int plan, const char *,
+        int, sqlite3_value ** argv)
+    {
+        auto & cursor = *static_cast<Cursor *>(cursor_base);
+        auto & table = *static_cast<Vtab *>(cursor.pVtab)->table;
+        auto size = table.data_->size();
+
+        switch(plan)
+        {
+        case key_lookup:
+            try
+            {
+                std::tie(cursor.pos, cursor.end) = table.key_range_(*table.data_, argv[0]);
+            }
+            catch(...)
+            {
+                return SQLITE_NOMEM;
+            }
+            break;
+
+        case rowid_lookup:
+        {
+            // compare as an integer, so that rowid = 1.5 matches nothing
+            sqlite3_int64 value = -1;
+            if(integral_value(argv[0], value) && value >= 0 && static_cast<sqlite3_uint64>(value) < size)
+            {
+                cursor.pos = static_cast<std::size_t>(value);
+                cursor.end = cursor.pos + 1;
+            }
+            else
+            {
+                cursor.pos = cursor.end = 0;
+            }
+            break;
+        }
+
+        default:
+            cursor.pos = 0;
+            cursor.end = size;
+            break;
+        }
+
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    bool Container_table<Container>::integral_value(sqlite3_value * value, sqlite3_int64 & integer)
+    {
+        switch(sqlite3_value_numeric_type(value))
+        {
+        case SQLITE_INTEGER:
+            integer = sqlite3_value_int64(value);
+            return true;
+
+        case SQLITE_FLOAT:
+        {
+            // bounds are -2^63 and 2^63, which are exact as doubles
+            auto real = sqlite3_value_double(value);
+            if(!(real >= -9223372036854775808.0 && real < 9223372036854775808.0) || std::trunc(real) != real)
+                return false;
+
+            integer = static_cast<sqlite3_int64>(real);
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    template<typename Container>
+    template<typename M>
+    bool Container_table<Container>::key_value(sqlite3_value * value, M & key, std::true_type, std::false_type)
+    {
+        sqlite3_int64 integer = 0;
+        if(!integral_value(value, integer))
+            return false;
+
+        // out of the key type's range
+        if((std::is_unsigned<M>::value && integer < 0) || static_cast<sqlite3_int64>(static_cast<M>(integer)) != integer)
+            return false;
+
+        key = static_cast<M>(integer);
+        return true;
+    }
+
+    template<typename Container>
+    template<typename M>
+    bool Container_table<Container>::key_value(sqlite3_value * value, M & key, std::false_type, std::true_type)
+    {
+        auto type = sqlite3_value_numeric_type(value);
+        if(type != SQLITE_INTEGER && type != SQLITE_FLOAT)
+            return false;
+
+        key = static_cast<M>(sqlite3_value_double(value));
+        return true;
+    }
+
+    template<typename Container>
+    template<typename M>
+    bool Container_table<Container>::key_value(sqlite3_value * value, M & key, std::false_type, std::false_type)
+    {
+        if(sqlite3_value_type(value) == SQLITE_NULL)
+            return false;
+
+        key = detail::Arg<M>::get(value);
+        return true;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::next(sqlite3_vtab_cursor * cursor)
+    {
+        ++static_cast<Cursor *>(cursor)->pos;
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::eof(sqlite3_vtab_cursor * cursor_base)
+    {
+        auto & cursor = *static_cast<Cursor *>(cursor_base);
+        return cursor.pos >= cursor.end;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::column_value(sqlite3_vtab_cursor * cursor_base, sqlite3_context * context, int column)
+    {
+        auto & cursor = *static_cast<Cursor *>(cursor_base);
+        auto & table = *static_cast<Vtab *>(cursor.pVtab)->table;
+
+        auto row = std::begin(*table.data_);
+        std::advance(row, cursor.pos);
+        table.columns_[column].get(context, *row);
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    int Container_table<Container>::rowid(sqlite3_vtab_cursor * cursor, sqlite3_int64 * rowid)
+    {
+        *rowid = static_cast<sqlite3_int64>(static_cast<Cursor *>(cursor)->pos);
+        return SQLITE_OK;
+    }
+
+    template<typename Container>
+    template<typename M>
+    const char * Container_table<Container>::sql_type()
+    {
+        if(std::is_integral<M>::value)
+            return "INTEGER";
+        else if(std::is_floating_point<M>::value)
+            return "REAL";
+        else if(std::is_same<M, std::string>::value)
+            return "TEXT";
+        else if(std::is_same<M, std::vector<unsigned char>>::value)
+            return "BLOB";
+        else
+            return "";
+    }
+
+    // the container outlives the statement, so column values are not copied
+    template<typename Container>
+    void Container_table<Container>::set_column(sqlite3_context * context, const std::string & val)
+    {
+        sqlite3_result_text64(context, val.data(), val.size(), SQLITE_STATIC, SQLITE_UTF8);
+    }
+
+    template<typename Container>
+    void Container_table<Container>::set_column(sqlite3_context * context, const std::vector<unsigned char> & val)
+    {
+        // a null pointer would give NULL instead of an empty blob
+        sqlite3_result_blob64(context, val.empty() ? "" : static_cast<const void *>(val.data()), val.size(), SQLITE_STATIC);
+    }
+
+    template<typename Container>
+    template<typename M>
+    void Container_table<Container>::set_column(sqlite3_context * context, const M & val)
+    {
+        detail::set_result(context, val);
+    }
+
+    template<typename Container>
+    void Connection::create_container_table(const std::string & name, Container_table<Container> table)
+    {
+        using Table = Container_table<Container>;
+
+        // sqlite calls destroy, even if registration fails
+        int status = sqlite3_create_module_v2(db_, name.c_str(), Table::module(),
+            new Table(std::move(table)), detail::destroy<Table>);
+        if(status != SQLITE_OK)
+            throw Logic_error("Error creating module " + name + ": " + sqlite3_errstr(status), "", status, db_);
+    }
+};
+
+# endif // SQLITE_CONTAINER_TABLE_HPP
@@ -0,0 +1,372 @@
+/// @file
+/// @brief Registration of C++ callables as SQL functions
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_FUNCTION_HPP
+#define SQLITE_FUNCTION_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// @cond INTERNAL
+    namespace detail
+    {
+        /// Argument and return types of a callable
+        template<typename F>
+        struct Callable_traits: Callable_traits<decltype(&F::operator())> {};
+
+        template<typename R, typename... Args>
+        struct Callable_traits<R(Args...)>
+        {
+            using result = R;
+            using args = std::tuple<Args...>;
+        };
+
+        template<typename R, typename... Args>
+        struct Callable_traits<R(*)(Args...)>: Callable_traits<R(Args...)> {};
+
+        template<typename R, typename C, typename... Args>
+        struct Callable_traits<R(C::*)(Args...)>: Callable_traits<R(Args...)> {};
+
+        template<typename R, typename C, typename... Args>
+        struct Callable_traits<R(C::*)(Args...) const>: Callable_traits<R(Args...)> {};
+
+#if __cpp_noexcept_function_type
+        template<typename R, typename... Args>
+        struct Callable_traits<R(*)(Args...) noexcept>: Callable_traits<R(Args...)> {};
+
+        template<typename R, typename C, typename... Args>
+        struct Callable_traits<R(C::*)(Args...) noexcept>: Callable_traits<R(Args...)> {};
+
+        template<typename R, typename C, typename... Args>
+        struct Callable_traits<R(C::*)(Args...) const noexcept>: Callable_traits<R(Args...)> {};
+#endif
+
+        /// Tuple type without its first element (the aggregate state)
+        template<typename Tuple>
+        struct Tail;
+
+        template<typename First, typename... Rest>
+        struct Tail<std::tuple<First, Rest...>>
+        {
+            using type = std::tuple<Rest...>;
+        };
+
+        /// Convert a sqlite3_value to a function argument
+        template<typename T, typename Enable = void>
+        struct Arg
+        {
+            static_assert(sizeof(T) == 0, "Unsupported SQL function argument type");
+        };
+
+        template<>
+        struct Arg<bool>
+        {
+            static bool get(sqlite3_value * value) { return sqlite3_value_int(value) != 0; }
+        };
+
+        template<typename T>
+        struct Arg<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+        {
+            static T get(sqlite3_value * value) { return static_cast<T>(sqlite3_value_int64(value)); }
+        };
+
+        template<typename T>
+        struct Arg<T, std::enable_if_t<std::is_floating_point<T>::value>>
+        {
+            static T get(sqlite3_value * value) { return static_cast<T>(sqlite3_value_double(value)); }
+        };
+
+        template<>
+        struct Arg<Text_view>
+        {
+            static Text_view get(sqlite3_value * value)
+            {
+                // text must be fetched before its size
+                auto text = reinterpret_cast<const char *>(sqlite3_value_text(value));
+                return Text_view(text, sqlite3_value_bytes(value));
+            }
+        };
+
+        template<>
+        struct Arg<std::string>
+        {
+            static std::string get(sqlite3_value * value) { return Arg<Text_view>::get(value).str(); }
+        };
+
+        template<>
+        struct Arg<Blob_view>
+        {
+            static Blob_view get(sqlite3_value * value)
+            {
+                // blob must be fetched before its size
+                auto blob = sqlite3_value_blob(value);
+                return Blob_view(blob, sqlite3_value_bytes(value));
+            }
+        };
+
+        template<>
+        struct Arg<std::vector<unsigned char>>
+        {
+            static std::vector<unsigned char> get(sqlite3_value * value)
+            {
+                auto blob = static_cast<const unsigned char *>(Arg<Blob_view>::get(value).data());
+                return std::vector<unsigned char>(blob, blob + sqlite3_value_bytes(value));
+            }
+        };
+
+        template<>
+        struct Arg<sqlite3_value *>
+        {
+            static sqlite3_value * get(sqlite3_value * value) { return value; }
+        };
+
+        /// @name Set a function's result
+        /// @{
+        void set_result(sqlite3_context * context, const sqlite3_int64 val);
+        void set_result(sqlite3_context * context, const double val);
+        void set_result(sqlite3_context * context, const Text_view val);
+        void set_result(sqlite3_context * context, const std::string & val);
+        void set_result(sqlite3_context * context, const char * val);
+        void set_result(sqlite3_context * context, const Blob_view val);
+        void set_result(sqlite3_context * context, const std::vector<unsigned char> & val);
+        void set_result(sqlite3_context * context, std::nullptr_t);
+
+        template<typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+        void set_result(sqlite3_context * context, const T val)
+        {
+            set_result(context, static_cast<sqlite3_int64>(val));
+        }
+
+        inline void set_result(sqlite3_context * context, const float val)
+        {
+            set_result(context, static_cast<double>(val));
+        }
+        /// @}
+
+        /// Report the exception currently being handled as the function's error
+        void set_error(sqlite3_context * context) noexcept;
+
+        /// Call \c func with arguments unpacked from \c argv, and set its result
+        template<typename R, typename... Args>
+        struct Invoker
+        {
+            template<typename F, typename... Front, std::size_t... Indexes>
+            static void call(sqlite3_context * context, F & func, sqlite3_value ** argv,
+                std::index_sequence<Indexes...>, Front &... front)
+            {
+                set_result(context, func(front..., Arg<std::decay_t<Args>>::get(argv[Indexes])...));
+            }
+        };
+
+        template<typename... Args>
+        struct Invoker<void, Args...>
+        {
+            template<typename F, typename... Front, std::size_t... Indexes>
+            static void call(sqlite3_context *, F & func, sqlite3_value ** argv,
+                std::index_sequence<Indexes...>, Front &... front)
+            {
+                func(front..., Arg<std::decay_t<Args>>::get(argv[Indexes])...);
+            }
+        };
+
+        template<typename R, typename Tuple>
+        struct Invoker_for;
+
+        template<typename R, typename... Args>
+        struct Invoker_for<R, std::tuple<Args...>>
+        {
+            using type = Invoker<R, Args...>;
+            static constexpr int arity = sizeof...(Args);
+        };
+
+        /// Delete user data owned by sqlite
+        template<typename T>
+        void destroy(void * data)
+        {
+            delete static_cast<T *>(data);
+        }
+
+        /// Callbacks for a scalar function
+        template<typename F>
+        struct Scalar
+        {
+            using Traits = Callable_traits<F>;
+            using Call = Invoker_for<typename Traits::result, typename Traits::args>;
+
+            static void func(sqlite3_context * context, int, sqlite3_value ** argv)
+            {
+                try
+                {
+                    auto & f = *static_cast<F *>(sqlite3_user_data(context));
+                    Call::type::call(context, f, argv, std::make_index_sequence<Call::arity>{});
+                }
+                catch(...)
+                {
+                    set_error(context);
+                }
+            }
+        };
+
+        /// Callables for an aggregate or window function
+        template<typename State, typename Step, typename Final, typename Value = std::nullptr_t, typename Inverse = std::nullptr_t>
+        struct Aggregate
+        {
+            Step step_func;
+            Final final_func;
+            Value value_func;
+            Inverse inverse_func;
+
+            using Step_call = Invoker_for<void, typename Tail<typename Callable_traits<Step>::args>::type>;
+            using Final_traits = Callable_traits<Final>;
+
+            /// Get this group's state, creating it on first use
+            static State * state(sqlite3_context * context)
+            {
+                auto slot = static_cast<State **>(sqlite3_aggregate_context(context, sizeof(State *)));
+                if(!slot)
+                    throw std::bad_alloc();
+                if(!*slot)
+                    *slot = new State();
+                return *slot;
+            }
+
+            static void step(sqlite3_context * context, int, sqlite3_value ** argv)
+            {
+                try
+                {
+                    auto & self = *static_cast<Aggregate *>(sqlite3_user_data(context));
+                    Step_call::type::call(context, self.step_func, argv,
+                        std::make_index_sequence<Step_call::arity>{}, *state(context));
+                }
+                catch(...)
+                {
+                    set_error(context);
+                }
+            }
+
+            static void final(sqlite3_context * context)
+            {
+                // the slot is only allocated if step was called
+                auto slot = static_cast<State **>(sqlite3_aggregate_context(context, 0));
+                std::unique_ptr<State> state(slot ? *slot : nullptr);
+                if(slot)
+                    *slot = nullptr;
+
+                try
+                {
+                    auto & self = *static_cast<Aggregate *>(sqlite3_user_data(context));
+                    if(!state)
+                        state.reset(new State());
+                    Invoker<typename Final_traits::result>::call(context, self.final_func, nullptr,
+                        std::index_sequence<>{}, *state);
+                }
+                catch(...)
+                {
+                    set_error(context);
+                }
+            }
+
+            static void value(sqlite3_context * context)
+            {
+                try
+                {
+                    auto & self = *static_cast<Aggregate *>(sqlite3_user_data(context));
+                    Invoker<typename Callable_traits<Value>::result>::call(context, self.value_func, nullptr,
+                        std::index_sequence<>{}, *state(context));
+                }
+                catch(...)
+                {
+                    set_error(context);
+                }
+            }
+
+            static void inverse(sqlite3_context * context, int, sqlite3_value ** argv)
+            {
+                using Inverse_call = Invoker_for<void, typename Tail<typename Callable_traits<Inverse>::args>::type>;
+                try
+                {
+                    auto & self = *static_cast<Aggregate *>(sqlite3_user_data(context));
+                    Inverse_call::type::call(context, self.inverse_func, argv,
+                        std::make_index_sequence<Inverse_call::arity>{}, *state(context));
+                }
+                catch(...)
+                {
+                    set_error(context);
+                }
+            }
+        };
+    };
+    /// @endcond
+
+    template<typename F>
+    void Connection::create_function(const std::string & name, F && func, int flags)
+    {
+        using Func = std::decay_t<F>;
+        using Scalar = detail::Scalar<Func>;
+
+        // sqlite calls destroy, even if registration fails
+        int status = sqlite3_create_function_v2(db_, name.c_str(), Scalar::Call::arity, SQLITE_UTF8 | flags,
+            new Func(std::forward<F>(func)), Scalar::func, nullptr, nullptr, detail::destroy<Func>);
+        check_function_status(name, status);
+    }
+
+    template<typename State, typename Step, typename Final>
+    void Connection::create_aggregate(const std::string & name, Step && step, Final && final, int flags)
+    {
+        using Aggregate = detail::Aggregate<State, std::decay_t<Step>, std::decay_t<Final>>;
+
+        int status = sqlite3_create_function_v2(db_, name.c_str(), Aggregate::Step_call::arity, SQLITE_UTF8 | flags,
+            new Aggregate{std::forward<Step>(step), std::forward<Final>(final), nullptr, nullptr},
+            nullptr, Aggregate::step, Aggregate::final, detail::destroy<Aggregate>);
+        check_function_status(name, status);
+    }
+
+#if SQLITE_VERSION_NUMBER >= 3025000
+    template<typename State, typename Step, typename Final, typename Value, typename Inverse>
+    void Connection::create_window_function(const std::string & name, Step && step, Final && final,
+        Value && value, Inverse && inverse, int flags)
+    {
+        using Aggregate = detail::Aggregate<State, std::decay_t<Step>, std::decay_t<Final>,
+            std::decay_t<Value>, std::decay_t<Inverse>>;
+
+        int status = sqlite3_create_window_function(db_, name.c_str(), Aggregate::Step_call::arity, SQLITE_UTF8 | flags,
+            new Aggregate{std::forward<Step>(step), std::forward<Final>(final),
+                std::forward<Value>(value), std::forward<Inverse>(inverse)},
+            Aggregate::step, Aggregate::final, Aggregate::value, Aggregate::inverse, detail::destroy<Aggregate>);
+        check_function_status(name, status);
+    }
+#endif
+};
+
+# endif // SQLITE_FUNCTION_HPP
@@ -0,0 +1,197 @@
+/// @file
+/// @brief Thread-safe pool of database connections
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_POOL_HPP
+#define SQLITE_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Thread-safe pool of connections to a single database file
+
+    /// Holds a set of read-only connections and a single writer connection, with
+    /// the database in WAL mode, so that readers on different threads can run
+    /// concurrently with each other and with the writer.
+    ///
+    /// Connections are checked out with reader() or writer(), which return a
+    /// Pool::Lease that returns the connection to the pool when destroyed. Each
+    /// connection keeps its own statement cache (see Connection::cached_statement),
+    /// which persists between checkouts.
+    ///
+    /// @note The database must be a file - each connection to \c :memory: would be a separate DB.
+    /// The pool must outlive all of its leases.
+    class Pool final
+    {
+    public:
+        class Lease;
+
+        /// Pool settings
+        struct Options
+        {
+            std::size_t readers = 4; ///< Number of read-only connections
+            std::size_t statement_cache_size = 64; ///< Statement cache capacity for each connection. \c 0 to disable
+
+            /// Settings for each connection. The writer is always switched to WAL mode,
+            /// and readers are always opened with \c query_only set
+            Connection::Open_options connection_options = Connection::Open_options::read_mostly_service();
+        };
+
+        /// Checkout counters
+
+        /// This is the return type for reader_stats() and writer_stats()
+        struct Stats
+        {
+            std::size_t size = 0; ///< Number of connections
+            std::size_t in_use = 0; ///< Number of connections currently checked out
+            std::uint64_t checkouts = 0; ///< Number of successful checkouts
+            std::uint64_t timeouts = 0; ///< Number of checkouts that timed out
+            std::chrono::nanoseconds total_wait{}; ///< Total time spent waiting for a connection
+            std::chrono::nanoseconds max_wait{}; ///< Longest time spent waiting for a connection
+            std::chrono::nanoseconds total_held{}; ///< Total time connections were checked out, not counting current checkouts
+            std::chrono::nanoseconds elapsed{}; ///< Time since the pool was opened
+
+            /// Get fraction of connection time spent checked out
+
+            /// @returns \c total_held / (\c elapsed * \c size), between \c 0 and \c 1
+            double utilization() const;
+        };
+
+        /// Open connections
+
+        /// @param[in] filename Path to sqlite database file
+        /// @param[in] options Pool settings
+        /// @exception Runtime_error on error connecting to DB or applying settings
+        Pool(const std::string & filename, const Options & options);
+
+        /// @copybrief Pool(const std::string &, const Options &)
+
+        /// Uses default Options
+        /// @param[in] filename Path to sqlite database file
+        /// @exception Runtime_error on error connecting to DB or applying settings
+        explicit Pool(const std::string & filename);
+
+        ~Pool();
+
+        // non-copyable, non-movable (leases point to their pool)
+        Pool(const Pool &) = delete;
+        Pool & operator=(const Pool &) = delete;
+
+        /// Check out a read-only connection
+
+        /// Waits for a connection to become available if all are in use
+        /// @param[in] timeout Max time to wait
+        /// @returns Checked out connection
+        /// @exception Runtime_error if no connection became available before the timeout
+        Lease reader(std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+        /// Check out the writer connection
+
+        /// Waits for the connection to become available if it is in use
+        /// @param[in] timeout Max time to wait
+        /// @returns Checked out connection
+        /// @exception Runtime_error if the connection didn't become available before the timeout
+        Lease writer(std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+        /// Get read-only connection counters
+        Stats reader_stats() const;
+
+        /// Get writer connection counters
+        Stats writer_stats() const;
+
+    private:
+        /// Connections of one kind (readers or writer) and their counters
+        struct Group
+        {
+            std::vector<std::unique_ptr<Connection>> connections; ///< All connections
+            std::vector<Connection *> idle; ///< Connections available for checkout
+            std::condition_variable available; ///< Signalled when a connection is returned
+            Stats stats; ///< Counters
+        };
+
+        /// Check out a connection from a group
+        Lease checkout(Group & group, std::chrono::milliseconds timeout, const char * kind);
+
+        /// Return a connection to its group
+        void checkin(Group & group, Connection * db, std::chrono::steady_clock::time_point checkout_time) noexcept;
+
+        /// Get group counters
+        Stats stats(const Group & group) const;
+
+        mutable std::mutex mutex_; ///< Guards readers_ and writer_ idle lists and counters
+        Group readers_; ///< Read-only connections
+        Group writer_; ///< Writer connection
+        std::chrono::steady_clock::time_point start_; ///< Time the pool was opened
+    };
+
+    /// Connection checked out from a Pool
+
+    /// Returns the connection to the pool when destroyed. Any transaction left
+    /// open on the connection is rolled back when it is returned.
+    class Pool::Lease final
+    {
+    public:
+        ~Lease();
+
+        // non-copyable
+        Lease(const Lease &) = delete;
+        Lease & operator=(const Lease &) = delete;
+
+        // movable
+        Lease(Lease &&);
+        Lease & operator=(Lease &&);
+
+        /// Access the checked out connection
+        Connection & operator*();
+
+        /// Access the checked out connection
+        Connection * operator->();
+
+    private:
+        friend class Pool;
+
+        /// @param[in] pool (non-owning) Pool connection was checked out from
+        /// @param[in] group (non-owning) Pool group connection belongs to
+        /// @param[in] db (non-owning) Checked out connection
+        Lease(Pool * pool, Group * group, Connection * db);
+
+        /// Return connection to the pool
+        void release() noexcept;
+
+        Pool * pool_ = nullptr; ///< (non-owned) Pool connection was checked out from
+        Group * group_ = nullptr; ///< (non-owned) Pool group connection belongs to
+        Connection * db_ = nullptr; ///< (non-owned) Checked out connection
+        std::chrono::steady_clock::time_point checkout_time_; ///< Time connection was checked out
+    };
+};
+
+# endif // SQLITE_POOL_HPP
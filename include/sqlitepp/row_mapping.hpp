@@ -0,0 +1,312 @@
+/// @file
+/// @brief Struct to row mapping
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// sqlite.hpp includes this file after defining Connection, so include it first
+#include <sqlitepp/sqlite.hpp>
+
+#ifndef SQLITE_ROW_MAPPING_HPP
+#define SQLITE_ROW_MAPPING_HPP
+
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Struct member mapped to a table column
+
+    /// Created with field() or key_field(), and listed in Row_mapping::fields()
+    /// @tparam T Struct type
+    /// @tparam M Member type
+    /// @tparam Key \c true for a primary key column
+    template<typename T, typename M, bool Key>
+    struct Field
+    {
+        static constexpr bool key = Key; ///< \c true for a primary key column
+
+        const char * name; ///< Column name. Used verbatim in generated SQL
+        M T::* member; ///< Pointer to the member
+    };
+
+    /// Map a struct member to a column
+
+    /// @param[in] name Column name. Used verbatim in generated SQL
+    /// @param[in] member Pointer to the member
+    template<typename T, typename M>
+    constexpr Field<T, M, false> field(const char * name, M T::* member)
+    {
+        return {name, member};
+    }
+
+    /// Map a struct member to a primary key column
+
+    /// Key columns are used in the \c WHERE clause of update_sql(), instead of being updated
+    /// @param[in] name Column name. Used verbatim in generated SQL
+    /// @param[in] member Pointer to the member
+    template<typename T, typename M>
+    constexpr Field<T, M, true> key_field(const char * name, M T::* member)
+    {
+        return {name, member};
+    }
+
+    /// Describes how to store a struct in a table
+
+    /// Specialize this for each struct to be stored, with a \c table() function that returns
+    /// the table name, and a \c fields() function that returns a \c std::tuple of field() and
+    /// key_field() objects, one for each column.
+    ///
+    /// The generated SQL and the bind and column indexes are derived from the order of the
+    /// fields, so binding and decoding don't look anything up by name. Supported member types
+    /// are \c bool, integral and floating point types, \c std::string, and
+    /// <tt>std::vector<unsigned char></tt> (as a BLOB).
+    /// @code
+    /// struct Point { sqlite3_int64 id; double x, y; std::string label; };
+    ///
+    /// namespace sqlite
+    /// {
+    ///     template<>
+    ///     struct Row_mapping<Point>
+    ///     {
+    ///         static const char * table() { return "points"; }
+    ///         static auto fields()
+    ///         {
+    ///             return std::make_tuple(key_field("id", &Point::id), field("x", &Point::x),
+    ///                 field("y", &Point::y), field("label", &Point::label));
+    ///         }
+    ///     };
+    /// };
+    ///
+    /// auto insert = db.create_statement(sqlite::insert_sql<Point>(), SQLITE_PREPARE_PERSISTENT);
+    /// insert.bind_mapped(point);
+    /// insert.step();
+    ///
+    /// auto select = db.create_statement(sqlite::select_sql<Point>() + " WHERE x > ?;");
+    /// select.bind(1, 0.0);
+    /// for(auto & row: select.rows())
+    ///     points.push_back(row.get_mapped<Point>());
+    /// @endcode
+    /// @tparam T Struct type
+    template<typename T>
+    struct Row_mapping;
+
+    /// @cond INTERNAL
+    namespace detail
+    {
+        /// Type of Row_mapping<T>::fields()
+        template<typename T>
+        using Mapping_fields = decltype(Row_mapping<T>::fields());
+
+        /// Number of fields in Row_mapping<T>
+        template<typename T>
+        using Mapping_size = std::tuple_size<Mapping_fields<T>>;
+
+        /// Column name and key flag of a mapped field
+        struct Mapped_column
+        {
+            const char * name;
+            bool key;
+        };
+
+        /// Count key fields
+        template<typename Fields>
+        struct Key_count;
+
+        template<>
+        struct Key_count<std::tuple<>>
+        {
+            static constexpr std::size_t value = 0;
+        };
+
+        template<typename F, typename... Fs>
+        struct Key_count<std::tuple<F, Fs...>>
+        {
+            static constexpr std::size_t value = (F::key ? 1 : 0) + Key_count<std::tuple<Fs...>>::value;
+        };
+
+        /// Expand mapped_columns() fields
+        template<typename Fields, std::size_t... Indexes>
+        std::vector<Mapped_column> mapped_columns(const Fields & fields, std::index_sequence<Indexes...>)
+        {
+            return {Mapped_column{std::get<Indexes>(fields).name, std::tuple_element_t<Indexes, Fields>::key}...};
+        }
+
+        /// Get column names and key flags of Row_mapping<T>, in field order
+        template<typename T>
+        std::vector<Mapped_column> mapped_columns()
+        {
+            return mapped_columns(Row_mapping<T>::fields(), std::make_index_sequence<Mapping_size<T>::value>{});
+        }
+    };
+    /// @endcond
+
+    /// Get INSERT statement for a mapped struct
+
+    /// The statement has a bind variable for each field, numbered by the field's position,
+    /// for use with Connection::Stmt::bind_mapped().
+    /// Generated on the 1st call, and reused afterward
+    /// @returns <tt>INSERT INTO table (columns...) VALUES (?1, ?2, ...);</tt>
+    template<typename T>
+    const std::string & insert_sql()
+    {
+        static const std::string sql = []
+        {
+            std::string names, values;
+            auto columns = detail::mapped_columns<T>();
+            for(std::size_t i = 0; i < columns.size(); ++i)
+            {
+                if(i > 0)
+                {
+                    names += ", ";
+                    values += ", ";
+                }
+                names += columns[i].name;
+                values += "?" + std::to_string(i + 1);
+            }
+            return std::string("INSERT INTO ") + Row_mapping<T>::table() + " (" + names + ") VALUES (" + values + ");";
+        }();
+        return sql;
+    }
+
+    /// Get SELECT statement for a mapped struct
+
+    /// Selects a column for each field, in field order, for use with Connection::Stmt::get_mapped().
+    /// There is no terminating semicolon, so that \c WHERE, \c ORDER \c BY, etc. clauses can be appended.
+    /// Generated on the 1st call, and reused afterward
+    /// @returns <tt>SELECT columns... FROM table</tt>
+    template<typename T>
+    const std::string & select_sql()
+    {
+        static const std::string sql = []
+        {
+            std::string names;
+            auto columns = detail::mapped_columns<T>();
+            for(std::size_t i = 0; i < columns.size(); ++i)
+            {
+                if(i > 0)
+                    names += ", ";
+                names += columns[i].name;
+            }
+            return "SELECT " + names + " FROM " + Row_mapping<T>::table();
+        }();
+        return sql;
+    }
+
+    /// Get UPDATE statement for a mapped struct
+
+    /// Sets each non-key field, for the row matching all key_field() fields. Bind variables are
+    /// numbered by field position, as for insert_sql(), so Connection::Stmt::bind_mapped() binds both.
+    /// Generated on the 1st call, and reused afterward
+    /// @returns <tt>UPDATE table SET column = ?2, ... WHERE key = ?1;</tt>
+    template<typename T>
+    const std::string & update_sql()
+    {
+        static_assert(detail::Key_count<detail::Mapping_fields<T>>::value > 0, "Row_mapping needs a key_field for update_sql");
+        static_assert(detail::Key_count<detail::Mapping_fields<T>>::value < detail::Mapping_size<T>::value,
+            "Row_mapping needs a non-key field for update_sql");
+
+        static const std::string sql = []
+        {
+            std::string set, where;
+            auto columns = detail::mapped_columns<T>();
+            for(std::size_t i = 0; i < columns.size(); ++i)
+            {
+                auto & dest = columns[i].key ? where : set;
+                if(!dest.empty())
+                    dest += columns[i].key ? " AND " : ", ";
+                dest += columns[i].name + std::string(" = ?") + std::to_string(i + 1);
+            }
+            return std::string("UPDATE ") + Row_mapping<T>::table() + " SET " + set + " WHERE " + where + ";";
+        }();
+        return sql;
+    }
+
+    template<typename T>
+    void Connection::Stmt::bind_mapped(const T & obj)
+    {
+        auto count = bind_parameter_count();
+        if(static_cast<std::size_t>(count) != detail::Mapping_size<T>::value)
+            throw_mapping_error(detail::Mapping_size<T>::value, count, "bind variables");
+        bind_mapped(obj, Row_mapping<T>::fields(), std::make_index_sequence<detail::Mapping_size<T>::value>{});
+    }
+
+    template<typename T>
+    T Connection::Stmt::get_mapped()
+    {
+        T obj{};
+        get_mapped(obj);
+        return obj;
+    }
+
+    template<typename T>
+    void Connection::Stmt::get_mapped(T & obj)
+    {
+        auto count = column_count();
+        if(static_cast<std::size_t>(count) != detail::Mapping_size<T>::value)
+            throw_mapping_error(detail::Mapping_size<T>::value, count, "columns");
+        get_mapped(obj, Row_mapping<T>::fields(), std::make_index_sequence<detail::Mapping_size<T>::value>{});
+    }
+
+    template<typename T, typename Fields, std::size_t... Indexes>
+    void Connection::Stmt::bind_mapped(const T & obj, const Fields & fields, std::index_sequence<Indexes...>)
+    {
+        // braced init list guarantees left-to-right evaluation
+        int expand[] = {0, (bind_value(static_cast<int>(Indexes) + 1, obj.*(std::get<Indexes>(fields).member)), 0)...};
+        static_cast<void>(expand);
+    }
+
+    template<typename T, typename Fields, std::size_t... Columns>
+    void Connection::Stmt::get_mapped(T & obj, const Fields & fields, std::index_sequence<Columns...>)
+    {
+        int expand[] = {0, (get_value(static_cast<int>(Columns), obj.*(std::get<Columns>(fields).member)), 0)...};
+        static_cast<void>(expand);
+    }
+
+    template<typename T>
+    void Connection::Stmt::get_value(const int column, T & val)
+    {
+        // read arithmetic types as the type bind_all would bind them as
+        val = static_cast<T>(get_col<std::decay_t<typename detail::Bind_as<T>::type>>(column));
+    }
+
+    inline void Connection::Stmt::get_value(const int column, std::string & val)
+    {
+        get_col(column, val);
+    }
+
+    inline void Connection::Stmt::get_value(const int column, std::vector<unsigned char> & val)
+    {
+        get_col(column, val);
+    }
+
+    template<typename T>
+    T Connection::Stmt::Row::get_mapped() const
+    {
+        return stmt_->get_mapped<T>();
+    }
+};
+
+# endif // SQLITE_ROW_MAPPING_HPP
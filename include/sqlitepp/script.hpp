@@ -0,0 +1,104 @@
+/// @file
+/// @brief Multi-statement SQL scripts
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_SCRIPT_HPP
+#define SQLITE_SCRIPT_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sqlitepp/sqlite.hpp>
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Multi-statement SQL script
+
+    /// Runs each statement of a SQL string in turn, like Connection::exec, but result
+    /// rows are passed to the callback as Connection::Stmt::Row objects, so columns can be
+    /// retrieved as their native types instead of being converted to text.
+    ///
+    /// Each statement is prepared just before it is run, so later statements may refer to
+    /// tables created earlier in the script. Prepared statements can be kept, so running
+    /// the script again (a migration or seed script, for instance) doesn't re-parse it.
+    ///
+    /// @code
+    /// sqlite::Connection::Script script(db, "CREATE TABLE t (a, b); INSERT INTO t VALUES (1, 2.5); SELECT a, b FROM t;");
+    /// script.run([](std::size_t statement, const sqlite::Connection::Stmt::Row & row)
+    /// {
+    ///     std::cout << statement << ": " << row.get<int>(0) << ", " << row.get<double>(1) << "\n";
+    /// });
+    /// @endcode
+    /// @sa [C API](https://www.sqlite.org/c3ref/prepare.html)
+    class Connection::Script final
+    {
+    public:
+        /// Result row callback
+
+        /// Called with the index of the statement in the script (starting at 0, and
+        /// not counting empty statements), and a row of its results
+        using Callback = std::function<void(std::size_t statement, const Stmt::Row & row)>;
+
+        /// @param[in] db Database Connection to run script on. Must outlive this object
+        /// @param[in] sql SQL code of script. May contain any number of statements
+        /// @param[in] keep_statements \c true to keep statements prepared for the next run().
+        /// \c false to finalize each one after it's run
+        Script(Connection & db, const std::string & sql, bool keep_statements = true);
+
+        // movable
+        Script(Script &&) = default;
+        Script & operator=(Script &&) = default;
+
+        /// Run all statements in the script
+
+        /// Stops at the first error, or when \c callback throws. Statements run before then
+        /// are not rolled back, and the next run() starts again from the first statement.
+        /// @param[in] callback Called for each result row. May be empty to discard rows
+        /// @exception Logic_error on error parsing or evaluating SQL
+        /// @sa [C API](https://www.sqlite.org/c3ref/step.html)
+        void run(const Callback & callback = nullptr);
+
+        /// Get number of prepared statements being kept
+        std::size_t statement_count() const;
+
+        /// Finalize kept statements
+
+        /// They will be prepared again on the next run()
+        void clear();
+
+    private:
+        /// Run a statement, passing its rows to the callback
+        void run_statement(std::size_t index, Stmt & stmt, const Callback & callback);
+
+        sqlite3 * db_ = nullptr; ///< DB to run script on
+        std::string sql_; ///< SQL code of script
+        bool keep_statements_; ///< \c true to keep statements in statements_
+
+        std::vector<Stmt> statements_; ///< Kept prepared statements, in script order
+        std::size_t tail_ = 0; ///< Offset in sql_ of the first statement not in statements_
+    };
+};
+
+# endif // SQLITE_SCRIPT_HPP
@@ -24,9 +24,24 @@
 #ifndef SQLITE_HPP
 #define SQLITE_HPP
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <sqlitepp/sqlite3.h>
+#include <sqlitepp/view.hpp>
 
 /// Sqlite C++ wrapper and associated types
 
@@ -34,6 +49,12 @@
 /// @sa [C API](https://www.sqlite.org/c3ref/intro.html)
 namespace sqlite
 {
+    template<typename Container>
+    class Container_table;
+
+    template<typename T>
+    struct Row_mapping;
+
     /// Sqlite database connection
 
     /// Holds a connection to a database. SQL may be run with either the exec() method,
@@ -43,6 +64,13 @@ namespace sqlite
     {
     public:
         class Stmt;
+        class Stmt_cache;
+        class Cached_stmt;
+        class Blob;
+        class Bulk_inserter;
+        class Script;
+        class Busy_state;
+        class Profiler;
 
         /// Open / create new DB
 
@@ -50,6 +78,64 @@ namespace sqlite
         /// @exception Runtime_error on error connecting to DB
         /// @sa [C API](https://www.sqlite.org/c3ref/open.html)
         explicit Connection(const std::string & filename);
+
+        /// Connection settings, applied when the connection is opened
+
+        /// Pragmas left at their default values are not changed.
+        /// Presets for common workloads are available from read_mostly_service() and bulk_loader()
+        /// @sa [Pragmas](https://www.sqlite.org/pragma.html)
+        struct Open_options
+        {
+            /// Flags for \c sqlite3_open_v2, such as \c SQLITE_OPEN_READONLY, \c SQLITE_OPEN_URI,
+            /// or \c SQLITE_OPEN_SHAREDCACHE.
+            ///
+            /// \c SQLITE_OPEN_NOMUTEX avoids locking a mutex on every API call, but the
+            /// connection and its statements must then not be used from more than one thread at a time
+            /// @sa [C API](https://www.sqlite.org/c3ref/open.html)
+            int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+            std::string vfs; ///< Name of VFS module to use. Empty for the default
+
+            /// Number of this connection's lookaside memory slots. \c 0 to disable lookaside, \c -1 for the
+            /// default set with Config::set_lookaside()
+            /// @sa [C API](https://www.sqlite.org/malloc.html#lookaside)
+            int lookaside_slots = -1;
+            int lookaside_slot_size = 1200; ///< Size, in bytes, of each lookaside memory slot. Only used if \c lookaside_slots is set
+
+            std::string journal_mode; ///< Journal mode, such as \c "WAL". Empty for the default
+            std::string synchronous; ///< Sync mode: \c "OFF", \c "NORMAL", \c "FULL", or \c "EXTRA". Empty for the default
+            int cache_size = 0; ///< Page cache size, in pages if positive, or KiB if negative. \c 0 for the default
+            sqlite3_int64 mmap_size = -1; ///< Max size, in bytes, of memory-mapped I/O. \c 0 to disable, \c -1 for the default
+            int page_size = 0; ///< Page size, in bytes, for a new DB. \c 0 for the default
+            std::string temp_store; ///< Temp storage: \c "DEFAULT", \c "FILE", or \c "MEMORY". Empty for the default
+            int foreign_keys = -1; ///< \c 1 to enforce foreign keys, \c 0 to not, \c -1 for the default
+            std::vector<std::string> pragmas; ///< Other pragmas to run, without the leading \c PRAGMA, such as \c "query_only=ON"
+
+            /// Settings for a long-running service that mostly reads
+
+            /// No mutex, WAL journal with \c NORMAL sync, 64MiB page cache, 256MiB of
+            /// memory-mapped I/O, in-memory temp storage, and foreign keys enforced
+            /// @returns Read-mostly preset
+            static Open_options read_mostly_service();
+
+            /// Settings for loading large amounts of data
+
+            /// No mutex, WAL journal with sync \c OFF, 256MiB page cache, in-memory
+            /// temp storage, and foreign keys not enforced.
+            /// @warning With sync off, the most recent transactions may be lost on power failure
+            /// @returns Bulk loader preset
+            static Open_options bulk_loader();
+        };
+
+        /// Open / create new DB with settings
+
+        /// All settings are applied before the connection is returned. If any
+        /// of them fail, the connection is closed.
+        /// @param[in] filename Path to sqlite database file, or URI if \c SQLITE_OPEN_URI is set
+        /// @param[in] options Connection settings
+        /// @exception Runtime_error on error connecting to DB or applying settings
+        /// @sa [C API](https://www.sqlite.org/c3ref/open.html)
+        Connection(const std::string & filename, const Open_options & options);
+
         ~Connection();
 
         // non-copyable
@@ -62,11 +148,52 @@ namespace sqlite
 
         /// Create a new prepared statement
 
-        /// @param[in] sql SQL code to prepare
+        /// @param[in] sql SQL code to prepare. Only the first statement is prepared
+        /// @param[in] flags Bitwise-or of \c SQLITE_PREPARE_* flags. Use \c SQLITE_PREPARE_PERSISTENT
+        /// for statements that will be kept and reused many times, so that they don't use lookaside memory
         /// @return Prepared statement for the SQL code input
         /// @exception Logic_error on error parsing SQL
         /// @sa [C API](https://www.sqlite.org/c3ref/prepare.html)
-        Stmt create_statement(const std::string & sql);
+        Stmt create_statement(const Text_view sql, unsigned int flags = 0);
+
+        /// Get a prepared statement from the statement cache
+
+        /// If the statement cache is enabled (see set_statement_cache_size()) and
+        /// holds a statement for the same SQL code, it is handed out instead of
+        /// preparing a new one. When the returned Cached_stmt is destroyed, the
+        /// statement is reset, its bindings are cleared, and it is returned to the cache.
+        ///
+        /// If the cache is disabled, a newly prepared statement is returned, and
+        /// is finalized when the Cached_stmt is destroyed.
+        /// @param[in] sql SQL code to prepare
+        /// @return Leased prepared statement for the SQL code input
+        /// @exception Logic_error on error parsing SQL
+        /// @note The returned Cached_stmt must not outlive this Connection
+        Cached_stmt cached_statement(const std::string & sql);
+
+        /// Set the maximum number of statements held in the statement cache
+
+        /// When more statements than this are returned to the cache, the least
+        /// recently used are finalized.
+        /// @param[in] capacity Maximum number of cached statements. \c 0 (the default) disables the cache
+        void set_statement_cache_size(std::size_t capacity);
+
+        /// Statement cache counters
+
+        /// This is the return type for statement_cache_stats()
+        struct Stmt_cache_stats
+        {
+            std::size_t hits = 0; ///< Number of cached_statement() calls served from the cache
+            std::size_t misses = 0; ///< Number of cached_statement() calls that had to prepare a new statement
+            std::size_t evictions = 0; ///< Number of statements finalized to stay within capacity
+            std::size_t size = 0; ///< Number of statements currently in the cache
+            std::size_t capacity = 0; ///< Maximum number of statements in the cache
+        };
+
+        /// Get statement cache counters
+
+        /// @returns Current statement cache counters
+        Stmt_cache_stats statement_cache_stats() const;
 
         /// Execute SQL statement(s)
 
@@ -82,6 +209,18 @@ namespace sqlite
         void exec(const std::string & sql, int (*callback)(void *, int, char **, char **) = nullptr,
             void * arg = nullptr);
 
+        /// Execute SQL statement(s), without throwing
+
+        /// Like exec(), but returns the result code instead of throwing, and does not
+        /// allocate an error message. Use \c sqlite3_errmsg on get_c_obj() to get one.
+        /// @param[in] sql SQL code to execute. Must be NUL-terminated
+        /// @returns \c SQLITE_OK on success, or a sqlite (extended) error code
+        /// @sa [C API](https://www.sqlite.org/c3ref/exec.html)
+        int try_exec(const char * sql) noexcept;
+
+        /// @copydoc try_exec(const char *)
+        int try_exec(const std::string & sql) noexcept;
+
         /// Start a transaction
 
         /// @sa [C API](https://www.sqlite.org/lang_transaction.html)
@@ -141,6 +280,301 @@ namespace sqlite
         Column_metadata table_column_metadata(const std::string & table_name, const std::string & column_name,
             const std::string & db_name = "main");
 
+        /// Open a BLOB for incremental I/O
+
+        /// @param[in] table_name Table name
+        /// @param[in] column_name Column name
+        /// @param[in] rowid Row ID of the row containing the BLOB
+        /// @param[in] writable \c true to open the BLOB for reading and writing, \c false for read-only
+        /// @param[in] db_name DB name, or \c "main" if omitted
+        /// @returns Handle to the opened BLOB
+        /// @exception Runtime_error on error opening BLOB
+        /// @sa [C API](https://www.sqlite.org/c3ref/blob_open.html)
+        Blob open_blob(const std::string & table_name, const std::string & column_name, sqlite3_int64 rowid,
+            bool writable = false, const std::string & db_name = "main");
+
+#if SQLITE_VERSION_NUMBER >= 3036000 || defined(SQLITE_ENABLE_DESERIALIZE)
+        /// Serialize a DB to an image
+
+        /// The image is the same as the DB's file contents
+        /// @param[in] db_name DB name, or \c "main" if omitted
+        /// @returns DB image
+        /// @exception Runtime_error on error serializing
+        /// @sa [C API](https://www.sqlite.org/c3ref/serialize.html)
+        std::vector<unsigned char> serialize(const std::string & db_name = "main");
+
+        /// Serialize a DB to an image file
+
+        /// The file is written under a temporary name and then renamed, so that
+        /// processes reading the old image never see a partial one
+        /// @param[in] path Path of image file to write
+        /// @param[in] db_name DB name, or \c "main" if omitted
+        /// @exception Runtime_error on error serializing or writing the file
+        /// @sa [C API](https://www.sqlite.org/c3ref/serialize.html)
+        void serialize_to_file(const std::string & path, const std::string & db_name = "main");
+
+        /// Replace a DB with an in-memory copy of an image
+
+        /// @param[in] image DB image, as from serialize(). Copied into memory owned by sqlite
+        /// @param[in] read_only \c true to make the DB read-only
+        /// @param[in] db_name DB name, or \c "main" if omitted
+        /// @exception Runtime_error on error deserializing
+        /// @sa [C API](https://www.sqlite.org/c3ref/deserialize.html)
+        void deserialize(const Blob_view image, bool read_only = false, const std::string & db_name = "main");
+
+        /// Replace a DB with an image file
+
+        /// If \c read_only is \c false, the file is read into memory owned by sqlite, and the DB can be modified.
+        ///
+        /// If \c read_only is \c true, the file is memory-mapped, and the DB reads pages directly from
+        /// the mapping without copying them, so loading costs about as much as \c mmap. The mapping is
+        /// released when the DB is replaced again or the connection is closed. The file must not be
+        /// modified while it's mapped; serialize_to_file() replaces files without modifying them.
+        /// Pages are only read without copying up to sqlite's compile-time \c SQLITE_MAX_MMAP_SIZE
+        /// (about 2GB by default), which silently caps the \c mmap_size set here. Pages past that limit
+        /// are copied into the page cache as they're read.
+        /// Memory mapping is only available on POSIX systems. Elsewhere, the file is read into memory.
+        /// @param[in] path Path of image file to read
+        /// @param[in] read_only \c true to map the file read-only, without copying
+        /// @param[in] db_name DB name, or \c "main" if omitted
+        /// @exception Runtime_error on error reading the file or deserializing
+        /// @sa [C API](https://www.sqlite.org/c3ref/deserialize.html)
+        void deserialize_file(const std::string & path, bool read_only = false, const std::string & db_name = "main");
+#endif
+
+        /// Busy handling policy
+
+        /// Determines how long to wait and retry when a table is locked by another
+        /// connection, before giving up and letting the operation fail with \c SQLITE_BUSY.
+        /// The delay before retry \c n is <tt>initial_delay * multiplier ^ n</tt>,
+        /// limited to \c max_delay.
+        ///
+        /// Usually created with one of fixed(), exponential_backoff(), or deadline().
+        /// A default constructed policy retries every millisecond, with no limit
+        /// @sa set_busy_policy()
+        struct Busy_policy
+        {
+            std::chrono::microseconds initial_delay{1000}; ///< Delay before the first retry
+            std::chrono::microseconds max_delay{1000}; ///< Upper limit on the delay before any retry
+            double multiplier = 1.0; ///< Factor the delay grows by after each retry
+            bool jitter = false; ///< \c true to randomize each delay between half and all of its nominal value
+            int max_retries = -1; ///< Give up after this many retries. -1 for no limit
+            std::chrono::microseconds timeout{0}; ///< Give up once this much time has passed since the lock was first found busy. 0 for no limit
+
+            /// Retry at a fixed interval until a timeout
+
+            /// Similar to \c sqlite3_busy_timeout
+            /// @param[in] timeout Time to give up after
+            /// @param[in] interval Delay between retries
+            /// @returns Fixed timeout policy
+            static Busy_policy fixed(std::chrono::milliseconds timeout,
+                std::chrono::milliseconds interval = std::chrono::milliseconds{1});
+
+            /// Retry with exponentially growing, randomized delays, up to a number of retries
+
+            /// @param[in] initial_delay Delay before the first retry
+            /// @param[in] max_delay Upper limit on the delay before any retry
+            /// @param[in] max_retries Number of retries to give up after
+            /// @param[in] multiplier Factor the delay grows by after each retry
+            /// @returns Exponential backoff policy
+            static Busy_policy exponential_backoff(std::chrono::microseconds initial_delay,
+                std::chrono::microseconds max_delay, int max_retries, double multiplier = 2.0);
+
+            /// Retry with exponentially growing, randomized delays, until a deadline
+
+            /// @param[in] deadline Time since the lock was first found busy to give up after
+            /// @param[in] initial_delay Delay before the first retry
+            /// @param[in] max_delay Upper limit on the delay before any retry
+            /// @returns Deadline policy
+            static Busy_policy deadline(std::chrono::milliseconds deadline,
+                std::chrono::microseconds initial_delay = std::chrono::milliseconds{1},
+                std::chrono::microseconds max_delay = std::chrono::milliseconds{100});
+        };
+
+        /// Busy handling counters
+
+        /// This is the return type for busy_stats()
+        struct Busy_stats
+        {
+            std::uint64_t events = 0; ///< Number of times a lock was found busy
+            std::uint64_t retries = 0; ///< Number of retries after waiting
+            std::uint64_t give_ups = 0; ///< Number of busy events that ended in \c SQLITE_BUSY
+            std::chrono::nanoseconds wait_time{0}; ///< Total time spent in the busy handler
+        };
+
+        /// Set the busy handling policy
+
+        /// Replaces any busy timeout or handler set previously.
+        /// Busy events are counted in busy_stats()
+        /// @param[in] policy Busy handling policy
+        /// @sa [C API](https://www.sqlite.org/c3ref/busy_handler.html)
+        void set_busy_policy(const Busy_policy & policy);
+
+        /// Set a custom busy handler
+
+        /// Replaces any busy timeout or handler set previously.
+        /// Busy events, and time spent in \c handler are counted in busy_stats()
+        /// @param[in] handler Function called when a lock is busy, with the number
+        /// of times it has already been called for this busy event. Return \c true
+        /// to retry, or \c false to give up. Exceptions thrown by \c handler are
+        /// treated as \c false. An empty \c handler removes busy handling
+        /// @sa [C API](https://www.sqlite.org/c3ref/busy_handler.html)
+        void set_busy_handler(std::function<bool(int)> handler);
+
+        /// Remove busy handling
+
+        /// Busy locks will immediately fail with \c SQLITE_BUSY. Counters are kept
+        /// @sa [C API](https://www.sqlite.org/c3ref/busy_handler.html)
+        void clear_busy_handler();
+
+        /// Get busy handling counters
+
+        /// @returns Busy handling counters, accumulated since the first call to
+        /// set_busy_policy() or set_busy_handler(), or since reset_busy_stats()
+        Busy_stats busy_stats() const;
+
+        /// Reset busy handling counters to 0
+        void reset_busy_stats();
+
+        /// Latency profile for one SQL statement
+
+        /// This is the element type returned by profile()
+        struct Query_profile
+        {
+            std::string sql; ///< Normalized SQL code if built with \c SQLITE_ENABLE_NORMALIZE, otherwise SQL code as prepared
+            std::uint64_t calls = 0; ///< Number of times the statement was run to completion or reset
+            std::chrono::nanoseconds total{0}; ///< Total run time
+            std::chrono::nanoseconds p50{0}; ///< Median run time
+            std::chrono::nanoseconds p99{0}; ///< 99th percentile run time
+            std::chrono::nanoseconds max{0}; ///< Longest run time
+        };
+
+        /// Start collecting per-statement latency profiles
+
+        /// Run times are aggregated for each distinct SQL string into a histogram,
+        /// from which profile() estimates percentiles to within 25%.
+        ///
+        /// When sqlite and this library are built with \c SQLITE_ENABLE_NORMALIZE (see the
+        /// \c ENABLE_NORMALIZE CMake option), statements are grouped by their normalized SQL,
+        /// so the same query with different literals shares a histogram. Otherwise, which is
+        /// the default, they're grouped by the exact SQL prepared, and queries that differ only
+        /// in their literals are profiled separately. Use bound parameters to group them.
+        ///
+        /// Times are measured from when sqlite reports a statement starting to when it reports
+        /// it finished, as the time sqlite reports itself only has millisecond resolution on most platforms.
+        /// When neither profiling nor a slow query callback is enabled, no trace
+        /// callback is installed, and there is no overhead.
+        /// @note Replaces any trace callback set with \c sqlite3_trace_v2
+        /// @sa [C API](https://www.sqlite.org/c3ref/trace_v2.html)
+        void enable_profiling();
+
+        /// Stop collecting per-statement latency profiles
+
+        /// Profiles collected so far are kept until reset_profile()
+        void disable_profiling();
+
+        /// Get per-statement latency profiles
+
+        /// @returns A profile for each distinct SQL string (normalized, if available; see
+        /// enable_profiling()) run since profiling was enabled, or since reset_profile(),
+        /// ordered by descending total run time
+        /// @note Safe to call from any thread, even while statements are running on another
+        std::vector<Query_profile> profile() const;
+
+        /// Discard all collected profiles
+
+        /// @note Safe to call from any thread, even while statements are running on another
+        void reset_profile();
+
+        /// Set a callback for slow statements
+
+        /// Works independently of enable_profiling().
+        /// @param[in] threshold Minimum run time for \c callback to be called
+        /// @param[in] callback Function called, on the thread running the statement, with the
+        /// SQL code (normalized, if available; see enable_profiling()) and run time of each
+        /// statement that takes at least \c threshold.
+        /// Empty to remove the callback. Must not throw
+        /// @note Replaces any trace callback set with \c sqlite3_trace_v2
+        /// @sa [C API](https://www.sqlite.org/c3ref/trace_v2.html)
+        void set_slow_query_callback(std::chrono::nanoseconds threshold,
+            std::function<void(const std::string & sql, std::chrono::nanoseconds time)> callback);
+
+        /// Register a C++ callable as an SQL scalar function
+
+        /// The number and types of the SQL function's arguments are deduced from \c func's
+        /// signature. Supported argument types are \c bool, integral and floating point types,
+        /// \c std::string, Text_view, Blob_view, <tt>std::vector<unsigned char></tt>, and
+        /// \c sqlite3_value* for direct access. Views are only valid during the call.
+        /// SQL values are converted to the argument type as by \c sqlite3_value_*, so \c NULL becomes 0 or empty.
+        ///
+        /// Supported return types are \c void and \c nullptr_t (returns \c NULL), \c bool,
+        /// integral and floating point types, \c std::string, \c const \c char*, Text_view,
+        /// Blob_view, and <tt>std::vector<unsigned char></tt>. Returned data is copied.
+        ///
+        /// An exception thrown by \c func becomes an SQL error, with the exception's message.
+        /// @param[in] name SQL function name. Registering the same name and number of arguments again replaces the function
+        /// @param[in] func Callable object (function pointer, lambda, or functor). A copy is kept until
+        /// the function is replaced or the connection is closed
+        /// @param[in] flags Additional function flags:
+        /// - \c SQLITE_DETERMINISTIC: \c func always gives the same result for the same arguments.
+        ///   Allows the query planner to optimize calls, and use in indexes
+        /// - \c SQLITE_INNOCUOUS (sqlite 3.31+): \c func has no side effects, and may be used in schema and triggers
+        /// - \c SQLITE_DIRECTONLY (sqlite 3.30+): \c func may only be called from top-level SQL
+        /// @exception Logic_error on error registering function
+        /// @note Include sqlitepp/function.hpp to use
+        /// @sa [C API](https://www.sqlite.org/c3ref/create_function.html)
+        template<typename F>
+        void create_function(const std::string & name, F && func, int flags = 0);
+
+        /// Register C++ callables as an SQL aggregate function
+
+        /// A \c State object is default-constructed for each group, passed to \c step for each row,
+        /// then to \c final to produce the result.
+        /// Arguments and results are as for create_function()
+        /// @tparam State Aggregate state type. Must be default-constructible
+        /// @param[in] name SQL function name
+        /// @param[in] step Called for each row, as <tt>void step(State &, Args...)</tt>. The SQL function
+        /// takes the same arguments, after \c State
+        /// @param[in] final Called for each group, as <tt>R final(State &)</tt>
+        /// @param[in] flags Additional function flags. See create_function()
+        /// @exception Logic_error on error registering function
+        /// @note Include sqlitepp/function.hpp to use
+        /// @sa [C API](https://www.sqlite.org/c3ref/create_function.html)
+        template<typename State, typename Step, typename Final>
+        void create_aggregate(const std::string & name, Step && step, Final && final, int flags = 0);
+
+#if SQLITE_VERSION_NUMBER >= 3025000
+        /// Register C++ callables as an SQL aggregate window function
+
+        /// Like create_aggregate(), but may also be used with an \c OVER clause
+        /// @tparam State Aggregate state type. Must be default-constructible
+        /// @param[in] name SQL function name
+        /// @param[in] step Called when a row enters the window, as <tt>void step(State &, Args...)</tt>
+        /// @param[in] final Called for the result of each group, as <tt>R final(State &)</tt>
+        /// @param[in] value Called for the current result of the window, as <tt>R value(State &)</tt>
+        /// @param[in] inverse Called when a row leaves the window, as <tt>void inverse(State &, Args...)</tt>
+        /// @param[in] flags Additional function flags. See create_function()
+        /// @exception Logic_error on error registering function
+        /// @note Include sqlitepp/function.hpp to use
+        /// @sa [C API](https://www.sqlite.org/c3ref/create_function.html)
+        template<typename State, typename Step, typename Final, typename Value, typename Inverse>
+        void create_window_function(const std::string & name, Step && step, Final && final,
+            Value && value, Inverse && inverse, int flags = 0);
+#endif
+
+        /// Expose a C++ container as a read-only virtual table
+
+        /// The table can then be queried by name, without \c CREATE \c VIRTUAL \c TABLE,
+        /// and joined with other tables without copying the container.
+        /// See Container_table for details
+        /// @param[in] name Table name. Registering the same name again replaces the table
+        /// @param[in] table Table description, with the container and its columns
+        /// @exception Logic_error on error registering table
+        /// @note Include sqlitepp/container_table.hpp to use
+        /// @sa [C API](https://www.sqlite.org/c3ref/create_module.html)
+        template<typename Container>
+        void create_container_table(const std::string & name, Container_table<Container> table);
+
         /// Get wrapped C sqlite3 object (for use with the sqlite [C API](https://www.sqlite.org/c3ref/intro.html))
 
         /// @returns C sqlite3 object
@@ -154,6 +588,28 @@ namespace sqlite
     private:
         /// sqlite C API's DB connection obj
         sqlite3 * db_ = nullptr;
+
+        /// Statement cache. Allocated on first use, so that leased statements
+        /// can keep a stable pointer to it
+        std::unique_ptr<Stmt_cache> stmt_cache_;
+
+        /// Busy handler state. Allocated on first use, so sqlite can keep a
+        /// stable pointer to it
+        std::unique_ptr<Busy_state> busy_;
+
+        /// Latency profiling state. Allocated on first use, so sqlite can keep a
+        /// stable pointer to it
+        std::unique_ptr<Profiler> profiler_;
+
+        /// Memory-mapped DB images from deserialize_file(), by DB name. Unmapped when
+        /// destroyed, so they must be destroyed after the connection is closed
+        std::unordered_map<std::string, std::shared_ptr<const void>> images_;
+
+        /// Install or remove the trace callback, depending on whether profiler_ needs it
+        void update_trace();
+
+        /// Throw Logic_error if registering SQL function \c name failed
+        void check_function_status(const std::string & name, int status);
     };
 
     /// Prepared statement obj - usually created by Connection::create_statement
@@ -167,14 +623,37 @@ namespace sqlite
     class Connection::Stmt final
     {
     public:
+        class Row;
+        class Row_iterator;
+        class Rows;
+        class Column_batch;
+
+        /// Pre-resolved bind variable
+
+        /// Obtained from param(). Binding with a Param avoids looking up the bind
+        /// variable's name on every call, which binding by name does.
+        class Param final
+        {
+        public:
+            /// @param[in] index Bind variable index
+            constexpr explicit Param(const int index) noexcept: index_(index) {}
+
+            /// Get bind variable index
+            constexpr int index() const noexcept { return index_; }
+
+        private:
+            int index_; ///< Bind variable index
+        };
+
         /// Prepare a new statement for the given SQL
 
         /// It is usually easier to use Connection::create_statement instead of this
-        /// @param[in] sql SQL code to prepare
+        /// @param[in] sql SQL code to prepare. Only the first statement is prepared
         /// @param[in] db Database Connection to prepare statement for
+        /// @param[in] flags Bitwise-or of \c SQLITE_PREPARE_* flags
         /// @exception Logic_error on error parsing SQL
         /// @sa [C API](https://www.sqlite.org/c3ref/prepare.html)
-        Stmt(const std::string & sql, Connection & db);
+        Stmt(const Text_view sql, Connection & db, unsigned int flags = 0);
         ~Stmt();
 
         // non-copyable
@@ -210,6 +689,24 @@ namespace sqlite
         /// @overload bind(const int, const int)
         void bind(const int index, const char * val);
 
+        /// Bind text or blob var by index, with control over copying
+
+        /// @note As in the sqlite C API, bind var indexes start at 1
+        /// @param[in] index Bind variable index
+        /// @param[in] val Bind variable value
+        /// @param[in] destructor Determines the lifetime of the data viewed by \c val:
+        /// - \c SQLITE_TRANSIENT (default): sqlite makes its own copy of the data
+        /// - \c SQLITE_STATIC: the data is not copied. The caller guarantees it
+        ///   stays valid until the variable is re-bound or the statement is finalized
+        /// - Any other function: ownership of the data is passed to sqlite, which
+        ///   will call \c destructor on it when finished. This is done even if binding fails
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        void bind(const int index, const Text_view val, sqlite3_destructor_type destructor = SQLITE_TRANSIENT);
+
+        /// @overload bind(const int, const Text_view, sqlite3_destructor_type)
+        void bind(const int index, const Blob_view val, sqlite3_destructor_type destructor = SQLITE_TRANSIENT);
+
         /// Bind null by index
 
         /// @note As in the sqlite C API, bind var indexes start at 1
@@ -221,6 +718,16 @@ namespace sqlite
         /// @copydoc bind_null(const int)
         void bind(const int index);
 
+        /// Bind zero-filled BLOB by index
+
+        /// Useful to reserve space for a BLOB that will be written later with Connection::Blob
+        /// @note As in the sqlite C API, bind var indexes start at 1
+        /// @param[in] index Bind variable index
+        /// @param[in] size Size of the BLOB in bytes
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        void bind_zeroblob(const int index, const sqlite3_uint64 size);
+
         /// Bind var by name
 
         /// @param[in] name Bind variable name
@@ -241,6 +748,19 @@ namespace sqlite
         /// @overload bind(const std::string &, const int)
         void bind(const std::string & name, const char * val);
 
+        /// Bind text or blob var by name, with control over copying
+
+        /// @param[in] name Bind variable name
+        /// @param[in] val Bind variable value
+        /// @param[in] destructor Determines the lifetime of the data viewed by \c val.
+        /// See bind(const int, const Text_view, sqlite3_destructor_type)
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        void bind(const std::string & name, const Text_view val, sqlite3_destructor_type destructor = SQLITE_TRANSIENT);
+
+        /// @overload bind(const std::string &, const Text_view, sqlite3_destructor_type)
+        void bind(const std::string & name, const Blob_view val, sqlite3_destructor_type destructor = SQLITE_TRANSIENT);
+
         /// Bind null by name
 
         /// @param[in] name Bind variable name
@@ -251,6 +771,159 @@ namespace sqlite
         /// @copydoc bind_null(const std::string &)
         void bind(const std::string & name);
 
+        /// Bind zero-filled BLOB by name
+
+        /// Useful to reserve space for a BLOB that will be written later with Connection::Blob
+        /// @param[in] name Bind variable name
+        /// @param[in] size Size of the BLOB in bytes
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        void bind_zeroblob(const std::string & name, const sqlite3_uint64 size);
+
+        /// Bind var by pre-resolved handle
+
+        /// Equivalent to calling bind() with \c param.index() in place of \c param
+        /// @param[in] param Bind variable handle, from param()
+        /// @param[in] args Bind variable value, and optionally a destructor for Text_view and Blob_view
+        /// values. Leave empty to bind NULL
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        template<typename... Args>
+        void bind(const Param param, Args &&... args);
+
+        /// Bind null by pre-resolved handle
+
+        /// @param[in] param Bind variable handle, from param()
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        void bind_null(const Param param);
+
+        /// Bind zero-filled BLOB by pre-resolved handle
+
+        /// @param[in] param Bind variable handle, from param()
+        /// @param[in] size Size of the BLOB in bytes
+        /// @exception Logic_error on error binding
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        void bind_zeroblob(const Param param, const sqlite3_uint64 size);
+
+        /// Bind all vars by position
+
+        /// Binds the 1st argument to index 1, the 2nd to index 2, etc. The bind()
+        /// overload for each argument is chosen at compile time: integral types
+        /// that fit in an \c int bind as \c int, other integral types as
+        /// \c sqlite3_int64, floating point types as \c double, and \c nullptr
+        /// binds NULL. Any other type is passed to bind() unchanged.
+        /// @param[in] args Bind variable values
+        /// @exception Logic_error if the number of arguments doesn't match bind_parameter_count(),
+        /// or on error binding
+        template<typename... Args>
+        void bind_all(Args &&... args);
+
+        /// Bind all fields of a mapped struct by position
+
+        /// Binds each field listed in Row_mapping<T>::fields() to the index of its position
+        /// in the list (the 1st field to index 1, etc), as used by insert_sql() and update_sql().
+        /// Values are converted as for bind_all()
+        /// @param[in] obj Struct to bind fields from
+        /// @exception Logic_error if the number of fields doesn't match bind_parameter_count(),
+        /// or on error binding
+        template<typename T>
+        void bind_mapped(const T & obj);
+
+        /// @}
+
+        /// @name Non-throwing functions
+        /// Alternatives to bind(), step() and reset() that return a sqlite result
+        /// code instead of throwing, and never allocate. Use these in loops where
+        /// errors such as \c SQLITE_BUSY or \c SQLITE_LOCKED are expected and retried.
+        ///
+        /// Extended result codes are enabled, so compare <tt>(status & 0xff)</tt> with
+        /// primary result codes such as \c SQLITE_BUSY. Use \c sqlite3_errmsg on
+        /// Connection::get_c_obj() to get a message for an error.
+        /// @{
+
+        /// Bind var by index, without throwing
+
+        /// @note As in the sqlite C API, bind var indexes start at 1
+        /// @param[in] index Bind variable index
+        /// @param[in] val Bind variable value
+        /// @returns \c SQLITE_OK on success, or a sqlite error code
+        /// @sa bind(const int, const double)
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        int try_bind(const int index, const double val) noexcept;
+
+        /// @overload try_bind(const int, const double)
+        int try_bind(const int index, const int val) noexcept;
+
+        /// @overload try_bind(const int, const double)
+        int try_bind(const int index, const sqlite3_int64 val) noexcept;
+
+        /// @overload try_bind(const int, const double)
+        int try_bind(const int index, const std::string & val) noexcept;
+
+        /// @overload try_bind(const int, const double)
+        int try_bind(const int index, const char * val) noexcept;
+
+        /// Bind text or blob var by index, with control over copying, without throwing
+
+        /// @note As in the sqlite C API, bind var indexes start at 1
+        /// @param[in] index Bind variable index
+        /// @param[in] val Bind variable value
+        /// @param[in] destructor Determines the lifetime of the data viewed by \c val.
+        /// See bind(const int, const Text_view, sqlite3_destructor_type)
+        /// @returns \c SQLITE_OK on success, or a sqlite error code
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        int try_bind(const int index, const Text_view val, sqlite3_destructor_type destructor = SQLITE_TRANSIENT) noexcept;
+
+        /// @overload try_bind(const int, const Text_view, sqlite3_destructor_type)
+        int try_bind(const int index, const Blob_view val, sqlite3_destructor_type destructor = SQLITE_TRANSIENT) noexcept;
+
+        /// Bind null by index, without throwing
+
+        /// @note As in the sqlite C API, bind var indexes start at 1
+        /// @param[in] index Bind variable index
+        /// @returns \c SQLITE_OK on success, or a sqlite error code
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        int try_bind_null(const int index) noexcept;
+
+        /// @copydoc try_bind_null(const int)
+        int try_bind(const int index) noexcept;
+
+        /// Bind zero-filled BLOB by index, without throwing
+
+        /// @note As in the sqlite C API, bind var indexes start at 1
+        /// @param[in] index Bind variable index
+        /// @param[in] size Size of the BLOB in bytes
+        /// @returns \c SQLITE_OK on success, or a sqlite error code
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        int try_bind_zeroblob(const int index, const sqlite3_uint64 size) noexcept;
+
+        /// Bind var by pre-resolved handle, without throwing
+
+        /// Equivalent to calling try_bind() with \c param.index() in place of \c param
+        /// @param[in] param Bind variable handle, from param()
+        /// @param[in] args Bind variable value, and optionally a destructor for Text_view and Blob_view
+        /// values. Leave empty to bind NULL
+        /// @returns \c SQLITE_OK on success, or a sqlite error code
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_blob.html)
+        template<typename... Args>
+        int try_bind(const Param param, Args &&... args) noexcept;
+
+        /// Run the statement, without throwing
+
+        /// @returns
+        /// - \c SQLITE_ROW when a row of data is available
+        /// - \c SQLITE_DONE when the statement has finished
+        /// - A sqlite error code on error
+        /// @sa [C API](https://www.sqlite.org/c3ref/step.html)
+        int try_step() noexcept;
+
+        /// Reset the statement, without throwing
+
+        /// @returns \c SQLITE_OK, or the error code from the most recent try_step() if it failed
+        /// @sa [C API](https://www.sqlite.org/c3ref/reset.html)
+        int try_reset() noexcept;
+
         /// @}
 
         /// Get bind var name from index
@@ -269,12 +942,36 @@ namespace sqlite
         /// @sa [C API](https://www.sqlite.org/c3ref/bind_parameter_index.html)
         int bind_parameter_index(const std::string & name);
 
+        /// Get a pre-resolved handle for a bind var
+
+        /// Look up a bind var once, so that it can be bound repeatedly without
+        /// looking up its name each time.
+        /// @code
+        /// auto id = stmt.param(":id");
+        /// for(auto & item: items)
+        /// {
+        ///     stmt.bind(id, item.id);
+        ///     ...
+        /// }
+        /// @endcode
+        /// @param[in] name Bind variable name
+        /// @returns Bind variable handle. Only valid for this statement
+        /// @exception Logic_error on error finding index
+        /// @sa [C API](https://www.sqlite.org/c3ref/bind_parameter_index.html)
+        Param param(const std::string & name);
+
         /// Get number of bind parameters
 
         /// @returns Number of bind parameters
         /// @sa [C API](https://www.sqlite.org/c3ref/bind_parameter_count.html)
         int bind_parameter_count();
 
+        /// Get number of result columns
+
+        /// @returns Number of columns returned by the statement. \c 0 for statements that don't return data
+        /// @sa [C API](https://www.sqlite.org/c3ref/column_count.html)
+        int column_count();
+
         /// Run the statement.
 
         /// @returns
@@ -284,6 +981,47 @@ namespace sqlite
         /// @sa [C API](https://www.sqlite.org/c3ref/step.html)
         bool step();
 
+        /// Iterate over result rows
+
+        /// Returns a range that steps through the statement as it is iterated,
+        /// for use with range-based for loops and standard algorithms. Each row
+        /// is a lightweight view over the statement's current row - no data is
+        /// copied until it is retrieved with Row::get(). The statement is reset
+        /// when the range is destroyed, even if iteration stopped early.
+        /// @code
+        /// for(auto & row: stmt.rows())
+        ///     std::cout << row.get<std::string>(0) << "\n";
+        /// @endcode
+        /// @returns Range of result rows
+        /// @note Only one iteration over the range is possible
+        Rows rows();
+
+        /// Fetch result rows into columnar buffers
+
+        /// Steps through up to \c max_rows rows, storing each column's values contiguously
+        /// in \c batch, replacing its previous contents, so that columns can be processed
+        /// in tight loops. The batch's buffers are reused between calls, so fetching into the
+        /// same batch repeatedly doesn't allocate once it has grown large enough.
+        ///
+        /// Once all rows have been fetched, fetch() returns \c 0 until reset() is called.
+        /// @code
+        /// Connection::Stmt::Column_batch batch({Connection::Stmt::Column_batch::Type::real});
+        /// double sum = 0.0;
+        /// while(stmt.fetch(batch, 4096) > 0)
+        /// {
+        ///     auto values = batch.reals(0);
+        ///     for(std::size_t i = 0; i < batch.row_count(); ++i)
+        ///         sum += values[i];
+        /// }
+        /// stmt.reset();
+        /// @endcode
+        /// @param[out] batch Buffers to fill. Must have one column type for each result column
+        /// @param[in] max_rows Maximum number of rows to fetch
+        /// @returns Number of rows fetched. \c 0 once all rows have been fetched
+        /// @exception Logic_error if \c batch has the wrong number of columns, or on error evaluating SQL
+        /// @sa [C API](https://www.sqlite.org/c3ref/column_blob.html)
+        std::size_t fetch(Column_batch & batch, std::size_t max_rows);
+
         /// Get SELECTed column
 
         /// @param[in] column Column number
@@ -295,6 +1033,46 @@ namespace sqlite
         template<typename T>
         T get_col(const int column);
 
+        /// Get SELECTed text column into an existing buffer
+
+        /// Reuses \c val's storage, so repeated calls with the same buffer don't allocate
+        /// once it has grown large enough. Embedded NULs are preserved.
+        /// @param[in] column Column number, starting at 0
+        /// @param[out] val Column data for the current row. Empty for NULL data
+        /// @sa [C API](https://www.sqlite.org/c3ref/column_blob.html)
+        void get_col(const int column, std::string & val);
+
+        /// Get SELECTed blob column into an existing buffer
+
+        /// @copydetails get_col(const int, std::string &)
+        void get_col(const int column, std::vector<unsigned char> & val);
+
+        /// Get all SELECTed columns
+
+        /// Each column is retrieved with get_col(), using the corresponding type
+        /// from \c Ts (the 1st type for column 0, etc).
+        /// @returns Column data for the current row
+        /// @exception Logic_error if the number of types doesn't match column_count()
+        template<typename... Ts>
+        std::tuple<Ts...> get_row();
+
+        /// Get all SELECTed columns into a mapped struct
+
+        /// Each column is stored in the field at the same position in Row_mapping<T>::fields(),
+        /// as selected by select_sql()
+        /// @returns Struct with fields set from the current row
+        /// @exception Logic_error if the number of fields doesn't match column_count()
+        template<typename T>
+        T get_mapped();
+
+        /// Get all SELECTed columns into an existing mapped struct
+
+        /// Text and BLOB fields reuse their existing storage, as for get_col(const int, std::string &)
+        /// @param[out] obj Struct to set fields of from the current row
+        /// @exception Logic_error if the number of fields doesn't match column_count()
+        template<typename T>
+        void get_mapped(T & obj);
+
         /// Reset the statement
 
         /// Useful for inserting or updating multiple rows
@@ -319,6 +1097,66 @@ namespace sqlite
         /// @sa [C API](https://www.sqlite.org/c3ref/stmt_readonly.html)
         bool readonly();
 
+        /// Statement performance counters
+
+        /// This is the return type for status()
+        struct Status
+        {
+            int fullscan_steps = 0; ///< Number of times a table was stepped through in a full table scan
+            int sorts = 0; ///< Number of sort operations
+            int autoindexes = 0; ///< Number of rows inserted into automatically created transient indexes
+            int vm_steps = 0; ///< Number of virtual machine operations run
+            int reprepares = 0; ///< Number of times the statement was re-prepared because of a schema change
+            int runs = 0; ///< Number of times the statement was run
+            int memory_used = 0; ///< Bytes of memory used by the statement. Not affected by \c reset
+        };
+
+        /// Get statement performance counters
+
+        /// Non-zero \c fullscan_steps or \c autoindexes usually indicate a missing index
+        /// @param[in] reset \c true to reset the counters to 0 after reading them
+        /// @returns Counters accumulated since the statement was prepared, or last reset
+        /// @sa [C API](https://www.sqlite.org/c3ref/stmt_status.html)
+        Status status(bool reset = false);
+
+        /// Query plan loop performance counters
+
+        /// This is the element type returned by scan_status()
+        struct Scan_status
+        {
+            std::string name; ///< Name of the table or index the loop reads
+            std::string explain; ///< Description of the loop, in the style of EXPLAIN QUERY PLAN
+            sqlite3_int64 loops = 0; ///< Number of times the loop has run
+            sqlite3_int64 rows_visited = 0; ///< Number of rows visited by the loop
+            double estimated_rows = 0.0; ///< Query planner's estimate of rows output per run
+            int select_id = 0; ///< ID of the SELECT statement the loop is part of
+        };
+
+        /// Get per-loop query plan counters
+
+        /// @note Only available when sqlite, and this library, are built with \c SQLITE_ENABLE_STMT_SCANSTATUS
+        /// defined (see the \c ENABLE_STMT_SCANSTATUS CMake option). Otherwise, an empty list is returned
+        /// @param[in] reset \c true to reset the counters to 0 after reading them
+        /// @returns Counters for each loop in the statement's query plan
+        /// @sa [C API](https://www.sqlite.org/c3ref/stmt_scanstatus.html)
+        std::vector<Scan_status> scan_status(bool reset = false);
+
+        /// Get SQL code the statement was prepared from
+
+        /// @returns SQL code. Valid until the statement is destroyed
+        /// @sa [C API](https://www.sqlite.org/c3ref/expanded_sql.html)
+        const char * sql() const;
+
+        /// Get normalized SQL code
+
+        /// Literals are replaced with \c ?, and whitespace and keyword case are normalized, so that
+        /// statements that differ only in their literal values can be grouped together, for metrics
+        /// @note Only available when sqlite, and this library, are built with \c SQLITE_ENABLE_NORMALIZE
+        /// defined (see the \c ENABLE_NORMALIZE CMake option). Otherwise, \c nullptr is returned
+        /// @returns Normalized SQL code, or \c nullptr if unavailable. Valid until the statement is destroyed
+        /// @sa [C API](https://www.sqlite.org/c3ref/expanded_sql.html)
+        const char * normalized_sql() const;
+
         /// Get wrapped C sqlite3_stmt object (for use with the sqlite [C API](https://www.sqlite.org/c3ref/intro.html))
 
         /// @returns C sqlite3_stmt object
@@ -330,11 +1168,648 @@ namespace sqlite
         sqlite3_stmt * get_c_obj();
 
     private:
+        friend class Script;
+
+        /// Take ownership of an already prepared statement
+        Stmt(sqlite3_stmt * stmt, sqlite3 * db) noexcept;
+
+        /// Throw Logic_error for a failed bind by index
+        [[noreturn]] void throw_bind_error(const int index, const int status);
+
+        /// Throw Logic_error for a failed bind by name
+        [[noreturn]] void throw_bind_error(const std::string & name, const int status);
+
+        /// Throw Logic_error, with \c what followed by sqlite's error message
+        [[noreturn]] void throw_error(const char * what, const int status);
+
+        /// Throw Logic_error if \c count doesn't match bind_parameter_count()
+        void check_bind_count(std::size_t count);
+
+        /// Throw Logic_error if \c count doesn't match column_count()
+        void check_column_count(std::size_t count);
+
+        /// Throw Logic_error for a mapped struct whose number of fields doesn't match the statement
+
+        /// @param[in] fields Number of fields in the struct's Row_mapping
+        /// @param[in] count Statement's number of bind variables or columns
+        /// @param[in] what \c "bind variables" or \c "columns"
+        [[noreturn]] void throw_mapping_error(std::size_t fields, int count, const char * what);
+
+        /// Bind a single value for bind_all()
+        template<typename T>
+        void bind_value(const int index, T && val);
+
+        /// Bind NULL for bind_all()
+        void bind_value(const int index, std::nullptr_t);
+
+        /// Expand bind_all() args with their indexes
+        template<std::size_t... Indexes, typename... Args>
+        void bind_all(std::index_sequence<Indexes...>, Args &&... args);
+
+        /// Expand get_row() types with their column numbers
+        template<typename... Ts, std::size_t... Columns>
+        std::tuple<Ts...> get_row(std::index_sequence<Columns...>);
+
+        /// Expand bind_mapped() fields with their indexes
+        template<typename T, typename Fields, std::size_t... Indexes>
+        void bind_mapped(const T & obj, const Fields & fields, std::index_sequence<Indexes...>);
+
+        /// Expand get_mapped() fields with their column numbers
+        template<typename T, typename Fields, std::size_t... Columns>
+        void get_mapped(T & obj, const Fields & fields, std::index_sequence<Columns...>);
+
+        /// Get a single column for get_mapped()
+        template<typename T>
+        void get_value(const int column, T & val);
+
+        /// Get a text column for get_mapped()
+        void get_value(const int column, std::string & val);
+
+        /// Get a BLOB column for get_mapped()
+        void get_value(const int column, std::vector<unsigned char> & val);
+
         /// Sqlite C API's prepared statement obj
         sqlite3_stmt * stmt_ = nullptr;
         /// Copy of sqlite DB connection obj
         sqlite3 * db_ = nullptr;
+        /// \c true once fetch() has reached the last row. Cleared by reset()
+        bool fetch_done_ = false;
     };
+
+    /// View of a statement's current result row
+
+    /// Produced by iterating over Connection::Stmt::rows. Valid until the statement is stepped again.
+    class Connection::Stmt::Row final
+    {
+    public:
+        /// Get column of the current row
+
+        /// @copydetails Connection::Stmt::get_col()
+        template<typename T>
+        T get(const int column) const;
+
+        /// Get text column of the current row into an existing buffer
+
+        /// @copydetails Connection::Stmt::get_col(const int, std::string &)
+        void get(const int column, std::string & val) const;
+
+        /// Get all columns of the current row
+
+        /// @copydetails Connection::Stmt::get_row()
+        template<typename... Ts>
+        std::tuple<Ts...> get_row() const;
+
+        /// Get all columns of the current row into a mapped struct
+
+        /// @copydetails Connection::Stmt::get_mapped()
+        template<typename T>
+        T get_mapped() const;
+
+        /// Get number of columns in the row
+        int column_count() const;
+
+        /// Get the statement this row belongs to
+        Stmt & stmt() const;
+
+    private:
+        friend class Row_iterator;
+
+        /// @param[in] stmt (non-owning) Statement to view, or \c nullptr
+        explicit Row(Stmt * stmt);
+
+        /// (non-owned) Statement being viewed
+        Stmt * stmt_ = nullptr;
+    };
+
+    /// Input iterator over a statement's result rows
+
+    /// Incrementing the iterator steps the statement. Created by Connection::Stmt::Rows
+    class Connection::Stmt::Row_iterator final
+    {
+    public:
+        using iterator_category = std::input_iterator_tag; ///< Iterator category
+        using value_type = Row; ///< Type yielded by iterator
+        using difference_type = std::ptrdiff_t; ///< Iterator difference type
+        using pointer = const Row *; ///< Pointer to value type
+        using reference = const Row &; ///< Reference to value type
+
+        /// Create an end iterator
+        Row_iterator();
+
+        /// Get current row
+        reference operator*() const;
+
+        /// Get current row
+        pointer operator->() const;
+
+        /// Step to the next row
+
+        /// @exception Logic_error on error evaluating SQL
+        Row_iterator & operator++();
+
+        /// Step to the next row
+
+        /// @exception Logic_error on error evaluating SQL
+        /// @note As with all input iterators, the returned copy is invalidated by the increment
+        Row_iterator operator++(int);
+
+        /// @returns \c true if both iterators are at the end, or both point into the same statement
+        bool operator==(const Row_iterator & other) const;
+
+        /// @returns \c false if both iterators are at the end, or both point into the same statement
+        bool operator!=(const Row_iterator & other) const;
+
+    private:
+        friend class Rows;
+
+        /// Steps the statement to its first row
+
+        /// @param[in] stmt (non-owning) Statement to iterate over
+        /// @exception Logic_error on error evaluating SQL
+        explicit Row_iterator(Stmt & stmt);
+
+        /// Current row. Holds \c nullptr when at the end
+        Row row_;
+    };
+
+    /// Single-pass range over a statement's result rows
+
+    /// Created by Connection::Stmt::rows. Resets the statement on destruction.
+    class Connection::Stmt::Rows final
+    {
+    public:
+        ~Rows();
+
+        // non-copyable
+        Rows(const Rows &) = delete;
+        Rows & operator=(const Rows &) = delete;
+
+        // movable
+        Rows(Rows &&);
+        Rows & operator=(Rows &&);
+
+        /// Step to the first row and get an iterator to it
+
+        /// @exception Logic_error on error evaluating SQL
+        Row_iterator begin();
+
+        /// Get the end iterator
+        Row_iterator end();
+
+    private:
+        friend class Stmt;
+
+        /// @param[in] stmt (non-owning) Statement to iterate over
+        explicit Rows(Stmt & stmt);
+
+        /// Reset the statement, ignoring errors
+        void reset() noexcept;
+
+        /// (non-owned) Statement to iterate over
+        Stmt * stmt_ = nullptr;
+    };
+
+    /// Columnar (struct of arrays) buffers for result rows
+
+    /// Filled by Connection::Stmt::fetch. Each column is stored in a contiguous array of
+    /// its type, so it can be processed in a tight loop, and a bitmap records which values are
+    /// NULL. Values are converted to the column's type as for Connection::Stmt::get_col, and
+    /// NULLs are stored as \c 0 or empty.
+    ///
+    /// Text and blob columns are stored as one buffer of concatenated values, and an array of
+    /// offsets into it: row \c i's value is from <tt>offsets(c)[i]</tt> to <tt>offsets(c)[i + 1]</tt>.
+    class Connection::Stmt::Column_batch final
+    {
+    public:
+        /// Column storage type
+        enum class Type {integer, real, text, blob};
+
+        /// @param[in] types Storage type for each result column, in order
+        explicit Column_batch(std::vector<Type> types);
+
+        /// Get number of rows in the batch
+        std::size_t row_count() const;
+
+        /// Get number of columns in the batch
+        std::size_t column_count() const;
+
+        /// Get a column's storage type
+
+        /// @param[in] column Column number, starting at 0
+        Type type(const int column) const;
+
+        /// Get integer column values
+
+        /// @param[in] column Column number, starting at 0
+        /// @returns Array of row_count() values
+        /// @exception Logic_error if the column isn't Type::integer
+        const sqlite3_int64 * integers(const int column) const;
+
+        /// Get real column values
+
+        /// @param[in] column Column number, starting at 0
+        /// @returns Array of row_count() values
+        /// @exception Logic_error if the column isn't Type::real
+        const double * reals(const int column) const;
+
+        /// Get text or blob column value offsets
+
+        /// @param[in] column Column number, starting at 0
+        /// @returns Array of row_count() + 1 offsets into data()
+        /// @exception Logic_error if the column isn't Type::text or Type::blob
+        const std::size_t * offsets(const int column) const;
+
+        /// Get text or blob column data
+
+        /// @param[in] column Column number, starting at 0
+        /// @returns Concatenated values for all rows
+        /// @exception Logic_error if the column isn't Type::text or Type::blob
+        const char * data(const int column) const;
+
+        /// Get a text column value
+
+        /// @param[in] column Column number, starting at 0
+        /// @param[in] row Row number, starting at 0
+        /// @returns Text value. Valid until the next fetch into this batch
+        /// @exception Logic_error if the column isn't Type::text or Type::blob
+        Text_view text(const int column, std::size_t row) const;
+
+        /// Get a blob column value
+
+        /// @param[in] column Column number, starting at 0
+        /// @param[in] row Row number, starting at 0
+        /// @returns Blob value. Valid until the next fetch into this batch
+        /// @exception Logic_error if the column isn't Type::text or Type::blob
+        Blob_view blob(const int column, std::size_t row) const;
+
+        /// Get a column's NULL bitmap
+
+        /// Bit <tt>i % 64</tt> of word <tt>i / 64</tt> is set if row \c i is NULL
+        /// @param[in] column Column number, starting at 0
+        /// @returns Array of <tt>(row_count() + 63) / 64</tt> words
+        const std::uint64_t * nulls(const int column) const;
+
+        /// Check if a value is NULL
+
+        /// @param[in] column Column number, starting at 0
+        /// @param[in] row Row number, starting at 0
+        bool is_null(const int column, std::size_t row) const;
+
+    private:
+        friend class Stmt;
+
+        /// Buffers for a single column. Only those for the column's type are used
+        struct Column
+        {
+            Type type; ///< Storage type
+            std::vector<sqlite3_int64> integers; ///< Values for Type::integer
+            std::vector<double> reals; ///< Values for Type::real
+            std::vector<std::size_t> offsets; ///< Offsets into data for Type::text and Type::blob
+            std::vector<char> data; ///< Concatenated values for Type::text and Type::blob
+            std::vector<std::uint64_t> nulls; ///< NULL bitmap
+        };
+
+        /// Get a column, checking that it has one of the given types
+        const Column & column(const int column, Type type, Type alt_type) const;
+
+        /// Remove all rows, keeping buffer capacity
+        void clear();
+
+        /// Grow buffers to hold more rows, up to \c max_rows
+        void grow(std::size_t max_rows);
+
+        std::vector<Column> columns_; ///< Column buffers
+        std::size_t rows_ = 0; ///< Number of rows stored
+        std::size_t capacity_ = 0; ///< Number of rows the buffers are sized for
+    };
+
+    /// Handle for incremental BLOB I/O - usually created by Connection::open_blob
+
+    /// Allows reading and writing parts of a BLOB without loading the whole
+    /// BLOB into memory. The size of a BLOB can not be changed through this handle.
+    /// To create a large BLOB, INSERT or UPDATE the row with Stmt::bind_zeroblob
+    /// first, then write to it. See Blob_buf for a \c std::streambuf adapter.
+    /// @sa [C API](https://www.sqlite.org/c3ref/blob.html)
+    class Connection::Blob final
+    {
+    public:
+        /// Open a BLOB for incremental I/O
+
+        /// It is usually easier to use Connection::open_blob instead of this
+        /// @param[in] db Database Connection containing the BLOB
+        /// @param[in] table_name Table name
+        /// @param[in] column_name Column name
+        /// @param[in] rowid Row ID of the row containing the BLOB
+        /// @param[in] writable \c true to open the BLOB for reading and writing, \c false for read-only
+        /// @param[in] db_name DB name, or \c "main" if omitted
+        /// @exception Runtime_error on error opening BLOB
+        /// @sa [C API](https://www.sqlite.org/c3ref/blob_open.html)
+        Blob(Connection & db, const std::string & table_name, const std::string & column_name, sqlite3_int64 rowid,
+            bool writable = false, const std::string & db_name = "main");
+        ~Blob();
+
+        // non-copyable
+        Blob(const Blob &) = delete;
+        Blob & operator=(const Blob &) = delete;
+
+        // movable
+        Blob(Blob &&);
+        Blob & operator=(Blob &&);
+
+        /// Get BLOB size
+
+        /// @returns Size of the BLOB in bytes
+        /// @sa [C API](https://www.sqlite.org/c3ref/blob_bytes.html)
+        std::size_t size() const;
+
+        /// Read from the BLOB
+
+        /// @param[out] data Buffer to read into. Must be at least \c size bytes
+        /// @param[in] size Number of bytes to read
+        /// @param[in] offset Offset into the BLOB to start reading from
+        /// @exception Runtime_error on error reading, including reading past the end of the BLOB
+        /// @sa [C API](https://www.sqlite.org/c3ref/blob_read.html)
+        void read(void * data, std::size_t size, std::size_t offset);
+
+        /// Write to the BLOB
+
+        /// @param[in] data Data to write
+        /// @param[in] size Number of bytes to write
+        /// @param[in] offset Offset into the BLOB to start writing at
+        /// @exception Runtime_error on error writing, including writing past the end of the BLOB,
+        /// or writing to a read-only BLOB
+        /// @sa [C API](https://www.sqlite.org/c3ref/blob_write.html)
+        void write(const void * data, std::size_t size, std::size_t offset);
+
+        /// Move the handle to a different row of the same table
+
+        /// Faster than opening a new handle
+        /// @param[in] rowid Row ID of the new row
+        /// @exception Runtime_error on error opening the new row
+        /// @sa [C API](https://www.sqlite.org/c3ref/blob_reopen.html)
+        void reopen(sqlite3_int64 rowid);
+
+        /// Get wrapped C sqlite3_blob object (for use with the sqlite [C API](https://www.sqlite.org/c3ref/intro.html))
+
+        /// @returns C sqlite3_blob object
+        const sqlite3_blob * get_c_obj() const;
+
+        /// Get wrapped C sqlite3_blob object (for use with the sqlite [C API](https://www.sqlite.org/c3ref/intro.html))
+
+        /// @returns C sqlite3_blob object
+        sqlite3_blob * get_c_obj();
+
+    private:
+        /// Sqlite C API's BLOB handle obj
+        sqlite3_blob * blob_ = nullptr;
+        /// Copy of sqlite DB connection obj
+        sqlite3 * db_ = nullptr;
+    };
+
+    /// LRU cache of prepared statements, keyed by SQL code
+
+    /// Owned by a Connection, and usually accessed through Connection::cached_statement
+    class Connection::Stmt_cache final
+    {
+    public:
+        /// @param[in] capacity Maximum number of cached statements
+        explicit Stmt_cache(std::size_t capacity);
+
+        // non-copyable, non-movable (Cached_stmt objects point to their cache)
+        Stmt_cache(const Stmt_cache &) = delete;
+        Stmt_cache & operator=(const Stmt_cache &) = delete;
+
+        /// Lease a statement from the cache
+
+        /// The statement is removed from the cache until the returned Cached_stmt
+        /// is destroyed. If no statement for the SQL code is cached, a new one is prepared
+        /// @param[in] sql SQL code to look up
+        /// @param[in] db Database Connection to prepare statement for on a cache miss
+        /// @returns Leased statement
+        /// @exception Logic_error on error parsing SQL
+        Cached_stmt lease(const std::string & sql, Connection & db);
+
+        /// Return a statement to the cache
+
+        /// The statement is reset and its bindings are cleared. If the cache
+        /// already holds a statement for the same SQL code, or is disabled, the
+        /// statement is finalized instead.
+        /// @param[in] sql SQL code statement was prepared from
+        /// @param[in] stmt Statement to cache
+        void put(const std::string & sql, Stmt && stmt) noexcept;
+
+        /// Set the maximum number of cached statements, evicting any over the limit
+        void set_capacity(std::size_t capacity);
+
+        /// Finalize all cached statements
+        void clear();
+
+        /// Get cache counters
+        Stmt_cache_stats stats() const;
+
+    private:
+        /// Evict least recently used statements over capacity
+        void evict();
+
+        /// Most recently used statement is at the front
+        using Lru_list = std::list<std::pair<std::string, Stmt>>;
+
+        std::size_t capacity_; ///< Max number of statements
+        Lru_list lru_; ///< Cached statements, in LRU order
+        std::unordered_map<std::string, Lru_list::iterator> index_; ///< Lookup for lru_ by SQL code
+        Stmt_cache_stats stats_; ///< hit / miss / eviction counters
+    };
+
+    /// Leased statement from a Connection's statement cache
+
+    /// Created by Connection::cached_statement. Returns the statement to the cache on destruction.
+    class Connection::Cached_stmt final
+    {
+    public:
+        ~Cached_stmt();
+
+        // non-copyable
+        Cached_stmt(const Cached_stmt &) = delete;
+        Cached_stmt & operator=(const Cached_stmt &) = delete;
+
+        // movable
+        Cached_stmt(Cached_stmt &&);
+        Cached_stmt & operator=(Cached_stmt &&);
+
+        /// Access the leased statement
+        Stmt & operator*();
+
+        /// Access the leased statement
+        Stmt * operator->();
+
+    private:
+        friend class Connection;
+        friend class Stmt_cache;
+
+        /// @param[in] sql SQL code statement was prepared from
+        /// @param[in] stmt Leased statement
+        /// @param[in] cache (non-owning) Cache to return statement to, or \c nullptr if the cache is disabled
+        Cached_stmt(std::string sql, Stmt && stmt, Stmt_cache * cache);
+
+        /// Return statement to cache, if any
+        void release() noexcept;
+
+        std::string sql_; ///< SQL code (cache key)
+        Stmt stmt_; ///< Leased statement
+        Stmt_cache * cache_ = nullptr; ///< (non-owned) cache statement came from
+    };
+
+    /// @cond INTERNAL
+
+    /// Busy handler state, passed to sqlite as the busy handler's user data
+    class Connection::Busy_state final
+    {
+    public:
+        /// Busy handler callback for sqlite
+        static int callback(void * state, int count) noexcept;
+
+        Busy_policy policy; ///< Busy handling policy, used when \c handler is empty
+        std::function<bool(int)> handler; ///< Custom busy handler
+        Busy_stats stats; ///< Busy handling counters
+        std::chrono::steady_clock::time_point event_start; ///< Time the current busy event started
+        std::uint32_t rng = 0x9e3779b9u; ///< Jitter PRNG state. Seeded by seed_rng()
+
+        /// Seed the jitter PRNG differently for each connection, so their retries desynchronize
+        void seed_rng();
+    };
+
+    /// Latency profiling state, passed to sqlite as the trace callback's user data
+    class Connection::Profiler final
+    {
+    public:
+        /// Log-linear latency histogram, with 4 buckets per power of 2
+        struct Histogram
+        {
+            static constexpr std::size_t num_buckets = 252; ///< Enough buckets for any 64-bit value
+
+            std::array<std::uint64_t, num_buckets> buckets{}; ///< Number of samples in each bucket
+            std::uint64_t calls = 0; ///< Total number of samples
+            std::uint64_t total = 0; ///< Sum of all samples
+            std::uint64_t max = 0; ///< Largest sample
+
+            /// Add a sample
+            void add(std::uint64_t ns);
+
+            /// Estimate a percentile
+
+            /// @param[in] fraction Percentile, from \c 0 to \c 1
+            /// @returns Upper bound of the bucket containing the percentile, limited to \c max
+            std::uint64_t percentile(double fraction) const;
+        };
+
+        /// Trace callback for sqlite
+        static int callback(unsigned int type, void * state, void * stmt, void * time) noexcept;
+
+        bool enabled = false; ///< \c true to record histograms
+
+        /// Guards histograms, key and running, as profile() and reset_profile() may be
+        /// called from a different thread than the one running statements
+        std::mutex mutex;
+        std::unordered_map<std::string, Histogram> histograms; ///< Histogram for each SQL string
+        std::string key; ///< Reused lookup key, to avoid allocating for each sample
+        std::vector<std::pair<sqlite3_stmt *, std::chrono::steady_clock::time_point>> running; ///< Start time of each running statement
+
+        std::chrono::nanoseconds slow_threshold{0}; ///< Minimum run time for slow_callback
+        std::function<void(const std::string &, std::chrono::nanoseconds)> slow_callback; ///< Slow query callback
+    };
+
+    /// @endcond
+
+    /// @cond INTERNAL
+    namespace detail
+    {
+        /// Type a value is converted to before calling Connection::Stmt::bind from Connection::Stmt::bind_all
+        template<typename T, typename Enable = void>
+        struct Bind_as
+        {
+            using type = const T &;
+        };
+
+        template<typename T>
+        struct Bind_as<T, std::enable_if_t<std::is_integral<T>::value>>
+        {
+            using type = std::conditional_t<(sizeof(T) < sizeof(int)) || (sizeof(T) == sizeof(int) && std::is_signed<T>::value),
+                  int, sqlite3_int64>;
+        };
+
+        template<typename T>
+        struct Bind_as<T, std::enable_if_t<std::is_floating_point<T>::value>>
+        {
+            using type = double;
+        };
+    };
+    /// @endcond
+
+    template<typename... Args>
+    void Connection::Stmt::bind(const Param param, Args &&... args)
+    {
+        bind(param.index(), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    int Connection::Stmt::try_bind(const Param param, Args &&... args) noexcept
+    {
+        return try_bind(param.index(), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    void Connection::Stmt::bind_all(Args &&... args)
+    {
+        check_bind_count(sizeof...(Args));
+        bind_all(std::index_sequence_for<Args...>{}, std::forward<Args>(args)...);
+    }
+
+    template<typename... Ts>
+    std::tuple<Ts...> Connection::Stmt::get_row()
+    {
+        check_column_count(sizeof...(Ts));
+        return get_row<Ts...>(std::index_sequence_for<Ts...>{});
+    }
+
+    template<typename T>
+    void Connection::Stmt::bind_value(const int index, T && val)
+    {
+        bind(index, static_cast<typename detail::Bind_as<std::decay_t<T>>::type>(val));
+    }
+
+    inline void Connection::Stmt::bind_value(const int index, std::nullptr_t)
+    {
+        bind_null(index);
+    }
+
+    template<typename T>
+    T Connection::Stmt::Row::get(const int column) const
+    {
+        return stmt_->get_col<T>(column);
+    }
+
+    template<typename... Ts>
+    std::tuple<Ts...> Connection::Stmt::Row::get_row() const
+    {
+        return stmt_->get_row<Ts...>();
+    }
+
+    template<std::size_t... Indexes, typename... Args>
+    void Connection::Stmt::bind_all(std::index_sequence<Indexes...>, Args &&... args)
+    {
+        // braced init list guarantees left-to-right evaluation
+        int expand[] = {0, (bind_value(static_cast<int>(Indexes) + 1, std::forward<Args>(args)), 0)...};
+        static_cast<void>(expand);
+    }
+
+    template<typename... Ts, std::size_t... Columns>
+    std::tuple<Ts...> Connection::Stmt::get_row(std::index_sequence<Columns...>)
+    {
+        return std::tuple<Ts...>{get_col<Ts>(static_cast<int>(Columns))...};
+    }
 };
 
+// template definitions for Connection::Stmt::bind_mapped and related functions
+#include <sqlitepp/row_mapping.hpp>
+
 # endif // SQLITE_HPP
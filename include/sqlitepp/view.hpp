@@ -0,0 +1,130 @@
+/// @file
+/// @brief Non-owning views of text and blob data
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SQLITE_VIEW_HPP
+#define SQLITE_VIEW_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/// @ingroup sqlite
+namespace sqlite
+{
+    /// Non-owning view of UTF-8 text
+
+    /// Used to pass and retrieve text without copying it. The viewed data is
+    /// not required to be NUL terminated, and may contain embedded NULs.
+    /// Converts to and from \c std::string_view when compiled as C++17 or later
+    class Text_view final
+    {
+    public:
+        /// Empty view
+        constexpr Text_view() noexcept = default;
+
+        /// @param[in] data Start of text. May be \c nullptr if \c size is 0
+        /// @param[in] size Length of text in bytes
+        constexpr Text_view(const char * data, std::size_t size) noexcept: data_(data), size_(size) {}
+
+        /// @param[in] str NUL terminated text, or \c nullptr for an empty view
+        Text_view(const char * str) noexcept: data_(str), size_(str ? std::strlen(str) : 0) {}
+
+        /// @param[in] str Text to view
+        Text_view(const std::string & str) noexcept: data_(str.data()), size_(str.size()) {}
+
+#if __cplusplus >= 201703L
+        /// @param[in] str Text to view
+        constexpr Text_view(std::string_view str) noexcept: data_(str.data()), size_(str.size()) {}
+
+        /// Convert to std::string_view
+        constexpr operator std::string_view() const noexcept { return {data_, size_}; }
+#endif
+
+        /// Get pointer to start of text
+        constexpr const char * data() const noexcept { return data_; }
+
+        /// Get length of text in bytes
+        constexpr std::size_t size() const noexcept { return size_; }
+
+        /// @returns \c true if the view has no data
+        constexpr bool empty() const noexcept { return size_ == 0; }
+
+        /// @returns Pointer to start of text
+        constexpr const char * begin() const noexcept { return data_; }
+
+        /// @returns Pointer to one past the end of text
+        constexpr const char * end() const noexcept { return data_ + size_; }
+
+        /// Copy viewed text into a std::string
+        std::string str() const { return data_ ? std::string(data_, size_) : std::string(); }
+
+    private:
+        const char * data_ = nullptr; ///< Start of text
+        std::size_t size_ = 0; ///< Length of text in bytes
+    };
+
+    /// Non-owning view of binary data
+
+    /// Used to pass and retrieve blobs without copying them
+    class Blob_view final
+    {
+    public:
+        /// Empty view
+        constexpr Blob_view() noexcept = default;
+
+        /// @param[in] data Start of data. May be \c nullptr if \c size is 0
+        /// @param[in] size Length of data in bytes
+        constexpr Blob_view(const void * data, std::size_t size) noexcept: data_(data), size_(size) {}
+
+        /// @param[in] data Contiguous data to view. Elements must be trivially copyable
+        template<typename T, typename = std::enable_if_t<std::is_trivially_copyable<T>::value>>
+        Blob_view(const std::vector<T> & data) noexcept: data_(data.data()), size_(data.size() * sizeof(T)) {}
+
+        /// Get pointer to start of data
+        constexpr const void * data() const noexcept { return data_; }
+
+        /// Get length of data in bytes
+        constexpr std::size_t size() const noexcept { return size_; }
+
+        /// @returns \c true if the view has no data
+        constexpr bool empty() const noexcept { return size_ == 0; }
+
+        /// @returns Pointer to first byte of data
+        const unsigned char * begin() const noexcept { return static_cast<const unsigned char *>(data_); }
+
+        /// @returns Pointer to one past the last byte of data
+        const unsigned char * end() const noexcept { return begin() + size_; }
+
+    private:
+        const void * data_ = nullptr; ///< Start of data
+        std::size_t size_ = 0; ///< Length of data in bytes
+    };
+};
+
+# endif // SQLITE_VIEW_HPP
@@ -0,0 +1,99 @@
+// Asynchronous query execution on a worker thread
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/async.hpp>
+
+namespace sqlite
+{
+    Async_connection::Async_connection(const std::string & filename, std::size_t statement_cache_size):
+        Async_connection(Connection(filename), statement_cache_size)
+    {
+    }
+
+    Async_connection::Async_connection(Connection && db, std::size_t statement_cache_size):
+        db_(std::move(db))
+    {
+        db_.set_statement_cache_size(statement_cache_size);
+        worker_ = std::thread(&Async_connection::run, this);
+    }
+
+    Async_connection::~Async_connection()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+
+    std::future<void> Async_connection::exec(const std::string & sql)
+    {
+        return submit([sql](Connection & db){ db.exec(sql); });
+    }
+
+    void Async_connection::post(Work work)
+    {
+        bool was_empty = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            was_empty = queue_.empty();
+            queue_.push_back(std::move(work));
+        }
+
+        // if the queue wasn't empty, the worker is already awake, or has been signalled
+        if(was_empty)
+            wake_.notify_one();
+    }
+
+    void Async_connection::run()
+    {
+        std::vector<Work> batch;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this]{ return stopping_ || !queue_.empty(); });
+
+                if(queue_.empty())
+                    return; // stopping, and all work is done
+
+                // take everything queued so far, so it can be run without re-locking for each item
+                std::swap(batch, queue_);
+            }
+
+            for(auto & work: batch)
+            {
+                try
+                {
+                    work(db_);
+                }
+                catch(...)
+                {
+                    // exceptions from submitted work are stored in their futures. Anything else is from a callback
+                }
+            }
+            batch.clear();
+        }
+    }
+};
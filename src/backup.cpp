@@ -0,0 +1,138 @@
+// online backup between database connections
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/backup.hpp>
+
+#include <thread>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    Backup::Backup(Connection & dest, Connection & source, const std::string & dest_name, const std::string & source_name):
+        dest_(dest.get_c_obj())
+    {
+        backup_ = sqlite3_backup_init(dest_, dest_name.c_str(), source.get_c_obj(), source_name.c_str());
+        if(!backup_)
+        {
+            // errors are reported on the destination connection
+            throw Runtime_error("Error starting backup ("s + source_name + " to " + dest_name + "): " +
+                sqlite3_errmsg(dest_), "", sqlite3_extended_errcode(dest_), dest_);
+        }
+    }
+
+    Backup::~Backup()
+    {
+        sqlite3_backup_finish(backup_);
+    }
+
+    Backup::Backup(Backup && other): backup_{other.backup_}, dest_{other.dest_}, cancelled_{other.cancelled_.load()}
+    {
+        other.backup_ = nullptr;
+    }
+
+    Backup & Backup::operator=(Backup && other)
+    {
+        if(&other != this)
+        {
+            sqlite3_backup_finish(backup_);
+            backup_ = other.backup_;
+            dest_ = other.dest_;
+            cancelled_ = other.cancelled_.load();
+            other.backup_ = nullptr;
+        }
+        return *this;
+    }
+
+    bool Backup::step(int pages)
+    {
+        int status = sqlite3_backup_step(backup_, pages);
+        switch(status & 0xff)
+        {
+        case SQLITE_DONE:
+            return true;
+
+        // locked by another connection. Try again later
+        case SQLITE_OK:
+        case SQLITE_BUSY:
+        case SQLITE_LOCKED:
+            return false;
+
+        default:
+            throw Runtime_error("Error copying backup: "s + sqlite3_errstr(status), "", status, dest_);
+        }
+    }
+
+    bool Backup::run(const Options & options, const Progress & progress)
+    {
+        while(!cancelled_)
+        {
+            if(step(options.pages_per_step))
+            {
+                if(progress)
+                    progress(remaining(), page_count());
+                return true;
+            }
+
+            if(progress && !progress(remaining(), page_count()))
+                return false;
+
+            if(options.sleep.count() > 0)
+                std::this_thread::sleep_for(options.sleep);
+            else
+                std::this_thread::yield();
+        }
+
+        return false;
+    }
+
+    bool Backup::run()
+    {
+        return run(Options());
+    }
+
+    void Backup::cancel()
+    {
+        cancelled_ = true;
+    }
+
+    int Backup::remaining() const
+    {
+        return sqlite3_backup_remaining(backup_);
+    }
+
+    int Backup::page_count() const
+    {
+        return sqlite3_backup_pagecount(backup_);
+    }
+
+    void Backup::finish()
+    {
+        int status = sqlite3_backup_finish(backup_);
+        backup_ = nullptr;
+        if(status != SQLITE_OK)
+            throw Runtime_error("Error finishing backup: "s + sqlite3_errstr(status), "", status, dest_);
+    }
+};
@@ -0,0 +1,123 @@
+// Sqlite incremental BLOB I/O wrapper
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/sqlite.hpp>
+
+#include <limits>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    /// sqlite's BLOB I/O functions take int sizes and offsets
+    constexpr auto max_blob_io = static_cast<std::size_t>(std::numeric_limits<int>::max());
+
+    Connection::Blob::Blob(Connection & db, const std::string & table_name, const std::string & column_name, sqlite3_int64 rowid,
+        bool writable, const std::string & db_name):
+        db_(db.get_c_obj())
+    {
+        int status = sqlite3_blob_open(db_, db_name.c_str(), table_name.c_str(), column_name.c_str(),
+            rowid, writable, &blob_);
+
+        if(status != SQLITE_OK)
+        {
+            // blob_ is set to NULL on failure
+            throw Runtime_error("Error opening BLOB (" +
+                db_name + "." + table_name + "." + column_name + ", row " + std::to_string(rowid) + "): " +
+                sqlite3_errmsg(db_), "", status, db_);
+        }
+    }
+
+    Connection::Blob::~Blob()
+    {
+        sqlite3_blob_close(blob_);
+    }
+
+    Connection::Blob::Blob(Connection::Blob && other): blob_{other.blob_}, db_{other.db_}
+    {
+        other.blob_ = nullptr;
+    }
+
+    Connection::Blob & Connection::Blob::operator=(Connection::Blob && other)
+    {
+        if(&other != this)
+        {
+            sqlite3_blob_close(blob_);
+            blob_ = other.blob_;
+            db_ = other.db_;
+            other.blob_ = nullptr;
+        }
+        return *this;
+    }
+
+    std::size_t Connection::Blob::size() const
+    {
+        return sqlite3_blob_bytes(blob_);
+    }
+
+    void Connection::Blob::read(void * data, std::size_t size, std::size_t offset)
+    {
+        if(size > max_blob_io || offset > max_blob_io)
+            throw Runtime_error("Error reading BLOB: size or offset out of range", "", SQLITE_RANGE, nullptr);
+
+        int status = sqlite3_blob_read(blob_, data, static_cast<int>(size), static_cast<int>(offset));
+        if(status != SQLITE_OK)
+        {
+            throw Runtime_error("Error reading BLOB: "s + sqlite3_errmsg(db_), "", status, db_);
+        }
+    }
+
+    void Connection::Blob::write(const void * data, std::size_t size, std::size_t offset)
+    {
+        if(size > max_blob_io || offset > max_blob_io)
+            throw Runtime_error("Error writing BLOB: size or offset out of range", "", SQLITE_RANGE, nullptr);
+
+        int status = sqlite3_blob_write(blob_, data, static_cast<int>(size), static_cast<int>(offset));
+        if(status != SQLITE_OK)
+        {
+            throw Runtime_error("Error writing BLOB: "s + sqlite3_errmsg(db_), "", status, db_);
+        }
+    }
+
+    void Connection::Blob::reopen(sqlite3_int64 rowid)
+    {
+        int status = sqlite3_blob_reopen(blob_, rowid);
+        if(status != SQLITE_OK)
+        {
+            throw Runtime_error("Error opening BLOB row " + std::to_string(rowid) + ": " +
+                sqlite3_errmsg(db_), "", status, db_);
+        }
+    }
+
+    const sqlite3_blob * Connection::Blob::get_c_obj() const
+    {
+        return blob_;
+    }
+
+    sqlite3_blob * Connection::Blob::get_c_obj()
+    {
+        return blob_;
+    }
+};
@@ -0,0 +1,142 @@
+// std::streambuf adapter for incremental BLOB I/O
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/blob_buf.hpp>
+
+#include <algorithm>
+
+namespace sqlite
+{
+    Blob_buf::Blob_buf(Connection::Blob & blob, std::size_t chunk_size):
+        blob_(blob),
+        buffer_(std::max<std::size_t>(chunk_size, 1))
+    {
+    }
+
+    Blob_buf::~Blob_buf()
+    {
+        try
+        {
+            flush();
+        }
+        catch(...)
+        {
+        }
+    }
+
+    Blob_buf::int_type Blob_buf::underflow()
+    {
+        auto pos = position();
+        flush();
+        buffer_offset_ = pos;
+
+        auto size = blob_.size();
+        if(pos >= size)
+            return traits_type::eof();
+
+        auto count = std::min(buffer_.size(), size - pos);
+        blob_.read(buffer_.data(), count, pos);
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + count);
+
+        return traits_type::to_int_type(*gptr());
+    }
+
+    Blob_buf::int_type Blob_buf::overflow(int_type ch)
+    {
+        auto pos = position();
+        flush();
+        buffer_offset_ = pos;
+
+        auto size = blob_.size();
+        if(pos >= size)
+            return traits_type::eof();
+
+        auto count = std::min(buffer_.size(), size - pos);
+        setp(buffer_.data(), buffer_.data() + count);
+
+        if(!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(ch);
+    }
+
+    int Blob_buf::sync()
+    {
+        try
+        {
+            auto pos = position();
+            flush();
+            buffer_offset_ = pos;
+        }
+        catch(...)
+        {
+            return -1;
+        }
+        return 0;
+    }
+
+    Blob_buf::pos_type Blob_buf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode)
+    {
+        off_type base = 0;
+        if(dir == std::ios_base::cur)
+            base = position();
+        else if(dir == std::ios_base::end)
+            base = blob_.size();
+
+        auto target = base + off;
+        if(target < 0 || target > static_cast<off_type>(blob_.size()))
+            return pos_type(off_type(-1));
+
+        flush();
+        buffer_offset_ = target;
+
+        return pos_type(target);
+    }
+
+    Blob_buf::pos_type Blob_buf::seekpos(pos_type pos, std::ios_base::openmode which)
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    std::size_t Blob_buf::position() const
+    {
+        if(gptr())
+            return buffer_offset_ + (gptr() - eback());
+        else if(pptr())
+            return buffer_offset_ + (pptr() - pbase());
+        else
+            return buffer_offset_;
+    }
+
+    void Blob_buf::flush()
+    {
+        if(pptr() && pptr() > pbase())
+            blob_.write(pbase(), pptr() - pbase(), buffer_offset_);
+
+        setg(nullptr, nullptr, nullptr);
+        setp(nullptr, nullptr);
+    }
+};
@@ -0,0 +1,289 @@
+// High-throughput bulk INSERTs
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/bulk_insert.hpp>
+
+#include <algorithm>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    double Connection::Bulk_inserter::Stats::rows_per_second() const
+    {
+        if(elapsed.count() <= 0.0)
+            return 0.0;
+
+        return rows / elapsed.count();
+    }
+
+    Connection::Bulk_inserter::Bulk_inserter(Connection & db, const std::string & table, const std::vector<std::string> & columns,
+        const Options & options):
+        db_(db),
+        columns_(columns.size()),
+        options_(options)
+    {
+        auto max_vars = static_cast<std::size_t>(sqlite3_limit(db_.get_c_obj(), SQLITE_LIMIT_VARIABLE_NUMBER, -1));
+
+        if(columns_ == 0 || columns_ > max_vars)
+        {
+            throw Logic_error("Can't bulk insert " + std::to_string(columns_) + " columns into " + table +
+                ": must be between 1 and " + std::to_string(max_vars), "", SQLITE_RANGE, db_.get_c_obj());
+        }
+
+        rows_per_statement_ = std::max<std::size_t>(1, std::min(max_vars / columns_, options_.rows_per_statement));
+
+        sql_prefix_ = "INSERT INTO " + table + " (";
+        sql_row_ = "(";
+        for(std::size_t i = 0; i < columns_; ++i)
+        {
+            if(i > 0)
+            {
+                sql_prefix_ += ", ";
+                sql_row_ += ",";
+            }
+            sql_prefix_ += columns[i];
+            sql_row_ += "?";
+        }
+        sql_prefix_ += ") VALUES ";
+        sql_row_ += ")";
+
+        values_.resize(rows_per_statement_ * columns_);
+
+        // prepare now, so errors in table or column names are reported immediately
+        statement(rows_per_statement_);
+    }
+
+    Connection::Bulk_inserter::Bulk_inserter(Connection & db, const std::string & table, const std::vector<std::string> & columns):
+        Bulk_inserter(db, table, columns, Options())
+    {
+    }
+
+    Connection::Bulk_inserter::~Bulk_inserter()
+    {
+        if(own_transaction_)
+            sqlite3_exec(db_.get_c_obj(), "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+
+    void Connection::Bulk_inserter::flush()
+    {
+        if(pending_rows_ > 0)
+            write_rows(pending_rows_);
+
+        commit();
+    }
+
+    Connection::Bulk_inserter::Stats Connection::Bulk_inserter::stats() const
+    {
+        auto stats = stats_;
+        if(stats.rows > 0 || pending_rows_ > 0)
+            stats.elapsed = std::chrono::steady_clock::now() - start_;
+        return stats;
+    }
+
+    void Connection::Bulk_inserter::check_column_count(std::size_t count) const
+    {
+        if(count != columns_)
+        {
+            throw Logic_error("Wrong number of values for bulk insert: expected " +
+                std::to_string(columns_) + ", got " + std::to_string(count), sql_prefix_, SQLITE_RANGE, db_.get_c_obj());
+        }
+    }
+
+    void Connection::Bulk_inserter::begin_row()
+    {
+        if(stats_.rows == 0 && pending_rows_ == 0)
+            start_ = std::chrono::steady_clock::now();
+
+        // don't interfere with a transaction the caller opened
+        if(!own_transaction_ && sqlite3_get_autocommit(db_.get_c_obj()))
+        {
+            db_.begin_transaction();
+            own_transaction_ = true;
+        }
+    }
+
+    void Connection::Bulk_inserter::end_row()
+    {
+        if(++pending_rows_ < rows_per_statement_)
+            return;
+
+        write_rows(pending_rows_);
+
+        if((options_.rows_per_commit > 0 && rows_since_commit_ >= options_.rows_per_commit) ||
+            (options_.bytes_per_commit > 0 && bytes_since_commit_ >= options_.bytes_per_commit))
+        {
+            commit();
+        }
+    }
+
+    void Connection::Bulk_inserter::store(const int val)
+    {
+        store(static_cast<sqlite3_int64>(val));
+    }
+
+    void Connection::Bulk_inserter::store(const sqlite3_int64 val)
+    {
+        auto & value = values_[next_value_++];
+        value.type = Value::Type::integer;
+        value.integer = val;
+        pending_bytes_ += sizeof(val);
+    }
+
+    void Connection::Bulk_inserter::store(const double val)
+    {
+        auto & value = values_[next_value_++];
+        value.type = Value::Type::real;
+        value.real = val;
+        pending_bytes_ += sizeof(val);
+    }
+
+    void Connection::Bulk_inserter::store(const Text_view val)
+    {
+        auto & value = values_[next_value_];
+        value.bytes.assign(val.begin(), val.end());
+        value.type = Value::Type::text;
+        ++next_value_;
+        pending_bytes_ += val.size();
+    }
+
+    void Connection::Bulk_inserter::store(const Blob_view val)
+    {
+        auto & value = values_[next_value_];
+        value.bytes.assign(reinterpret_cast<const char *>(val.begin()), reinterpret_cast<const char *>(val.end()));
+        value.type = Value::Type::blob;
+        ++next_value_;
+        pending_bytes_ += val.size();
+    }
+
+    void Connection::Bulk_inserter::store(std::nullptr_t)
+    {
+        values_[next_value_++].type = Value::Type::null;
+    }
+
+    void Connection::Bulk_inserter::write_rows(std::size_t rows)
+    {
+        try
+        {
+            if(rows == rows_per_statement_)
+            {
+                write_statement(statement(rows), 0, rows);
+            }
+            else
+            {
+                auto & stmt = statement(1);
+                for(std::size_t row = 0; row < rows; ++row)
+                    write_statement(stmt, row, 1);
+            }
+        }
+        catch(...)
+        {
+            // the buffer must be emptied, or the next insert() would write past its end
+            clear_pending();
+            throw;
+        }
+
+        rows_since_commit_ += rows;
+        bytes_since_commit_ += pending_bytes_;
+        clear_pending();
+    }
+
+    void Connection::Bulk_inserter::write_statement(Stmt & stmt, std::size_t first_row, std::size_t rows)
+    {
+        // the buffer isn't modified until after the statement is stepped, so there's no need for sqlite to copy it
+        for(std::size_t i = 0; i < rows * columns_; ++i)
+        {
+            auto & value = values_[first_row * columns_ + i];
+            int index = static_cast<int>(i) + 1;
+            switch(value.type)
+            {
+            case Value::Type::null:
+                stmt.bind_null(index);
+                break;
+            case Value::Type::integer:
+                stmt.bind(index, value.integer);
+                break;
+            case Value::Type::real:
+                stmt.bind(index, value.real);
+                break;
+            case Value::Type::text:
+                stmt.bind(index, Text_view(value.bytes), SQLITE_STATIC);
+                break;
+            case Value::Type::blob:
+                stmt.bind(index, Blob_view(value.bytes.data(), value.bytes.size()), SQLITE_STATIC);
+                break;
+            }
+        }
+
+        int status = stmt.try_step();
+        stmt.try_reset();
+        if(status != SQLITE_DONE)
+        {
+            throw Logic_error("Error evaluating SQL: "s + sqlite3_errmsg(db_.get_c_obj()), sqlite3_sql(stmt.get_c_obj()),
+                status, db_.get_c_obj());
+        }
+
+        stats_.rows += rows;
+        ++stats_.statements;
+    }
+
+    void Connection::Bulk_inserter::clear_pending()
+    {
+        pending_rows_ = 0;
+        next_value_ = 0;
+        pending_bytes_ = 0;
+    }
+
+    Connection::Stmt & Connection::Bulk_inserter::statement(std::size_t rows)
+    {
+        auto found = statements_.find(rows);
+        if(found != std::end(statements_))
+            return found->second;
+
+        std::string sql = sql_prefix_;
+        sql.reserve(sql.size() + rows * (sql_row_.size() + 1));
+        for(std::size_t i = 0; i < rows; ++i)
+        {
+            if(i > 0)
+                sql += ",";
+            sql += sql_row_;
+        }
+        sql += ";";
+
+        return statements_.emplace(rows, Stmt(sql, db_, SQLITE_PREPARE_PERSISTENT)).first->second;
+    }
+
+    void Connection::Bulk_inserter::commit()
+    {
+        if(own_transaction_)
+        {
+            db_.commit();
+            own_transaction_ = false;
+            ++stats_.commits;
+        }
+        rows_since_commit_ = 0;
+        bytes_since_commit_ = 0;
+    }
+};
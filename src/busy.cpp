@@ -0,0 +1,196 @@
+// busy handling policies and counters
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <sqlitepp/sqlite.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+namespace sqlite
+{
+    Connection::Busy_policy Connection::Busy_policy::fixed(std::chrono::milliseconds timeout,
+        std::chrono::milliseconds interval)
+    {
+        Busy_policy policy;
+        policy.initial_delay = policy.max_delay = interval;
+        policy.timeout = timeout;
+        return policy;
+    }
+
+    Connection::Busy_policy Connection::Busy_policy::exponential_backoff(std::chrono::microseconds initial_delay,
+        std::chrono::microseconds max_delay, int max_retries, double multiplier)
+    {
+        Busy_policy policy;
+        policy.initial_delay = initial_delay;
+        policy.max_delay = max_delay;
+        policy.multiplier = multiplier;
+        policy.jitter = true;
+        policy.max_retries = max_retries;
+        return policy;
+    }
+
+    Connection::Busy_policy Connection::Busy_policy::deadline(std::chrono::milliseconds deadline,
+        std::chrono::microseconds initial_delay, std::chrono::microseconds max_delay)
+    {
+        Busy_policy policy;
+        policy.initial_delay = initial_delay;
+        policy.max_delay = max_delay;
+        policy.multiplier = 2.0;
+        policy.jitter = true;
+        policy.timeout = deadline;
+        return policy;
+    }
+
+    int Connection::Busy_state::callback(void * state_ptr, int count) noexcept
+    {
+        auto & state = *static_cast<Busy_state *>(state_ptr);
+        auto now = std::chrono::steady_clock::now();
+
+        // sqlite starts the count over for each new busy event
+        if(count == 0)
+        {
+            ++state.stats.events;
+            state.event_start = now;
+        }
+
+        if(state.handler)
+        {
+            bool retry = false;
+            try
+            {
+                retry = state.handler(count);
+            }
+            catch(...)
+            {
+                retry = false;
+            }
+
+            state.stats.wait_time += std::chrono::steady_clock::now() - now;
+            ++(retry ? state.stats.retries : state.stats.give_ups);
+            return retry;
+        }
+
+        const auto & policy = state.policy;
+
+        if(policy.max_retries >= 0 && count >= policy.max_retries)
+        {
+            ++state.stats.give_ups;
+            return 0;
+        }
+
+        auto delay = std::min(static_cast<double>(policy.max_delay.count()),
+            policy.initial_delay.count() * std::pow(policy.multiplier, count));
+
+        if(policy.jitter)
+        {
+            // xorshift32 - quality isn't important here, only that competing connections desynchronize
+            state.rng ^= state.rng << 13;
+            state.rng ^= state.rng >> 17;
+            state.rng ^= state.rng << 5;
+            delay *= 0.5 + 0.5 * (state.rng / static_cast<double>(UINT32_MAX));
+        }
+
+        auto wait = std::chrono::microseconds{static_cast<std::chrono::microseconds::rep>(delay)};
+
+        if(policy.timeout.count() > 0)
+        {
+            auto remaining = policy.timeout - std::chrono::duration_cast<std::chrono::microseconds>(now - state.event_start);
+            if(remaining.count() <= 0)
+            {
+                ++state.stats.give_ups;
+                return 0;
+            }
+            wait = std::min(wait, remaining);
+        }
+
+        std::this_thread::sleep_for(wait);
+
+        state.stats.wait_time += std::chrono::steady_clock::now() - now;
+        ++state.stats.retries;
+        return 1;
+    }
+
+    void Connection::Busy_state::seed_rng()
+    {
+        // the clock separates processes, and the address separates connections within one
+        auto seed = static_cast<std::uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+        seed ^= static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(this)) * 0x9e3779b97f4a7c15u;
+        seed ^= std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+        // splitmix64 finalizer, to spread the bits
+        seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9u;
+        seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebu;
+        seed ^= seed >> 31;
+
+        // xorshift never leaves 0
+        rng = static_cast<std::uint32_t>(seed ^ (seed >> 32));
+        if(rng == 0)
+            rng = 0x9e3779b9u;
+    }
+
+    void Connection::set_busy_policy(const Busy_policy & policy)
+    {
+        if(!busy_)
+            busy_ = std::make_unique<Busy_state>();
+
+        busy_->policy = policy;
+        busy_->handler = nullptr;
+        busy_->seed_rng();
+        sqlite3_busy_handler(db_, Busy_state::callback, busy_.get());
+    }
+
+    void Connection::set_busy_handler(std::function<bool(int)> handler)
+    {
+        if(!handler)
+        {
+            clear_busy_handler();
+            return;
+        }
+
+        if(!busy_)
+            busy_ = std::make_unique<Busy_state>();
+
+        busy_->handler = std::move(handler);
+        sqlite3_busy_handler(db_, Busy_state::callback, busy_.get());
+    }
+
+    void Connection::clear_busy_handler()
+    {
+        sqlite3_busy_handler(db_, nullptr, nullptr);
+    }
+
+    Connection::Busy_stats Connection::busy_stats() const
+    {
+        if(!busy_)
+            return Busy_stats{};
+
+        return busy_->stats;
+    }
+
+    void Connection::reset_busy_stats()
+    {
+        if(busy_)
+            busy_->stats = Busy_stats{};
+    }
+};
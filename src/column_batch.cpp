@@ -0,0 +1,241 @@
+// Columnar batch fetch of result rows
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/sqlite.hpp>
+
+#include <algorithm>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    std::size_t Connection::Stmt::fetch(Column_batch & batch, std::size_t max_rows)
+    {
+        auto columns = column_count();
+        if(static_cast<std::size_t>(columns) != batch.columns_.size())
+        {
+            throw Logic_error("Wrong number of columns for batch fetch: batch has " +
+                std::to_string(batch.columns_.size()) + ", statement returns " + std::to_string(columns), sqlite3_sql(stmt_), SQLITE_RANGE, db_);
+        }
+
+        batch.clear();
+
+        // sqlite would restart the statement if it were stepped again
+        if(fetch_done_)
+            return 0;
+
+        // hold the connection's mutex for the whole batch, so that sqlite3_column_value's
+        // unprotected values can be read directly, instead of locking for each sqlite3_column_* call
+        struct Lock
+        {
+            sqlite3_mutex * mutex;
+            explicit Lock(sqlite3_mutex * mutex): mutex(mutex) { sqlite3_mutex_enter(mutex); }
+            ~Lock() { sqlite3_mutex_leave(mutex); }
+        } lock(sqlite3_db_mutex(db_));
+
+        auto column_data = batch.columns_.data();
+
+        std::size_t row = 0;
+        for(; row < max_rows; ++row)
+        {
+            int status = sqlite3_step(stmt_);
+            if(status == SQLITE_DONE)
+            {
+                fetch_done_ = true;
+                break;
+            }
+            else if(status != SQLITE_ROW)
+            {
+                batch.rows_ = row;
+                throw_error("Error evaluating SQL: ", status);
+            }
+
+            if(row == batch.capacity_)
+                batch.grow(max_rows);
+
+            auto null_word = row / 64;
+            auto null_bit = std::uint64_t{1} << (row % 64);
+
+            for(int c = 0; c < columns; ++c)
+            {
+                auto & column = column_data[c];
+                auto value = sqlite3_column_value(stmt_, c);
+                auto type = sqlite3_value_type(value);
+
+                if(type == SQLITE_NULL)
+                    column.nulls[null_word] |= null_bit;
+
+                // sqlite returns 0 for NULL numeric values
+                switch(column.type)
+                {
+                case Column_batch::Type::integer:
+                    column.integers[row] = sqlite3_value_int64(value);
+                    break;
+
+                case Column_batch::Type::real:
+                    column.reals[row] = sqlite3_value_double(value);
+                    break;
+
+                case Column_batch::Type::text:
+                case Column_batch::Type::blob:
+                    if(type != SQLITE_NULL)
+                    {
+                        // get data before size, as text conversion may change the size
+                        auto data = column.type == Column_batch::Type::text ?
+                            reinterpret_cast<const char *>(sqlite3_value_text(value)) :
+                            static_cast<const char *>(sqlite3_value_blob(value));
+                        auto size = sqlite3_value_bytes(value);
+                        if(data)
+                            column.data.insert(std::end(column.data), data, data + size);
+                    }
+                    column.offsets[row + 1] = column.data.size();
+                    break;
+                }
+            }
+        }
+
+        batch.rows_ = row;
+        return row;
+    }
+
+    Connection::Stmt::Column_batch::Column_batch(std::vector<Type> types)
+    {
+        columns_.resize(types.size());
+        for(std::size_t i = 0; i < types.size(); ++i)
+        {
+            columns_[i].type = types[i];
+            if(types[i] == Type::text || types[i] == Type::blob)
+                columns_[i].offsets.push_back(0);
+        }
+
+        clear();
+    }
+
+    std::size_t Connection::Stmt::Column_batch::row_count() const
+    {
+        return rows_;
+    }
+
+    std::size_t Connection::Stmt::Column_batch::column_count() const
+    {
+        return columns_.size();
+    }
+
+    Connection::Stmt::Column_batch::Type Connection::Stmt::Column_batch::type(const int column) const
+    {
+        return columns_.at(column).type;
+    }
+
+    const sqlite3_int64 * Connection::Stmt::Column_batch::integers(const int column) const
+    {
+        return this->column(column, Type::integer, Type::integer).integers.data();
+    }
+
+    const double * Connection::Stmt::Column_batch::reals(const int column) const
+    {
+        return this->column(column, Type::real, Type::real).reals.data();
+    }
+
+    const std::size_t * Connection::Stmt::Column_batch::offsets(const int column) const
+    {
+        return this->column(column, Type::text, Type::blob).offsets.data();
+    }
+
+    const char * Connection::Stmt::Column_batch::data(const int column) const
+    {
+        return this->column(column, Type::text, Type::blob).data.data();
+    }
+
+    Text_view Connection::Stmt::Column_batch::text(const int column, std::size_t row) const
+    {
+        auto & col = this->column(column, Type::text, Type::blob);
+        return Text_view(col.data.data() + col.offsets[row], col.offsets[row + 1] - col.offsets[row]);
+    }
+
+    Blob_view Connection::Stmt::Column_batch::blob(const int column, std::size_t row) const
+    {
+        auto & col = this->column(column, Type::text, Type::blob);
+        return Blob_view(col.data.data() + col.offsets[row], col.offsets[row + 1] - col.offsets[row]);
+    }
+
+    const std::uint64_t * Connection::Stmt::Column_batch::nulls(const int column) const
+    {
+        return columns_.at(column).nulls.data();
+    }
+
+    bool Connection::Stmt::Column_batch::is_null(const int column, std::size_t row) const
+    {
+        return (columns_.at(column).nulls[row / 64] >> (row % 64)) & 1;
+    }
+
+    const Connection::Stmt::Column_batch::Column & Connection::Stmt::Column_batch::column(const int column, Type type, Type alt_type) const
+    {
+        auto & col = columns_.at(column);
+        if(col.type != type && col.type != alt_type)
+            throw Logic_error("Wrong type requested for batch column " + std::to_string(column), "", SQLITE_MISMATCH, nullptr);
+
+        return col;
+    }
+
+    void Connection::Stmt::Column_batch::clear()
+    {
+        rows_ = 0;
+
+        // buffers keep their size, so they're only allocated until they've grown large enough
+        for(auto & column: columns_)
+        {
+            std::fill(std::begin(column.nulls), std::end(column.nulls), 0);
+            column.data.clear();
+            if(!column.offsets.empty())
+                column.offsets[0] = 0;
+        }
+    }
+
+    void Connection::Stmt::Column_batch::grow(std::size_t max_rows)
+    {
+        // start small, in case max_rows is much more than the statement returns
+        capacity_ = std::min(max_rows, std::max<std::size_t>(capacity_ * 2, 1024));
+
+        for(auto & column: columns_)
+        {
+            column.nulls.resize((capacity_ + 63) / 64);
+            switch(column.type)
+            {
+            case Type::integer:
+                column.integers.resize(capacity_);
+                break;
+
+            case Type::real:
+                column.reals.resize(capacity_);
+                break;
+
+            case Type::text:
+            case Type::blob:
+                column.offsets.resize(capacity_ + 1);
+                break;
+            }
+        }
+    }
+};
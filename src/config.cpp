@@ -0,0 +1,167 @@
+// process-wide sqlite configuration
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/config.hpp>
+
+#include <memory>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    namespace
+    {
+        // sqlite doesn't pass its app data pointer to the allocation functions,
+        // so they have to find the allocator through this
+        Config::Allocator * current_allocator = nullptr;
+
+        void * mem_allocate(int size) { return current_allocator->allocate(size); }
+        void mem_deallocate(void * ptr) { current_allocator->deallocate(ptr); }
+        void * mem_reallocate(void * ptr, int size) { return current_allocator->reallocate(ptr, size); }
+        int mem_size(void * ptr) { return current_allocator->size(ptr); }
+        int mem_round_up(int size) { return current_allocator->round_up(size); }
+        int mem_init(void *) { return SQLITE_OK; }
+        void mem_shutdown(void *) {}
+
+        // sqlite's own allocator, saved before the first custom one is installed
+        sqlite3_mem_methods default_methods;
+        bool default_methods_saved = false;
+
+        // preallocated page cache memory
+        std::unique_ptr<char[]> page_cache_memory;
+    }
+
+    void Config::throw_config_error(const char * what, int status)
+    {
+        if(status == SQLITE_MISUSE)
+            throw Logic_error(what + ": sqlite is already initialized. Configure before opening any connection, or after shutdown()"s,
+                "", status, nullptr);
+        else
+            throw Logic_error(what + ": "s + sqlite3_errstr(status), "", status, nullptr);
+    }
+
+    void Config::set_allocator(Allocator & allocator)
+    {
+        if(!default_methods_saved)
+        {
+            int status = sqlite3_config(SQLITE_CONFIG_GETMALLOC, &default_methods);
+            if(status != SQLITE_OK)
+                throw_config_error("Error setting allocator", status);
+            default_methods_saved = true;
+        }
+
+        sqlite3_mem_methods methods{mem_allocate, mem_deallocate, mem_reallocate, mem_size, mem_round_up, mem_init, mem_shutdown, nullptr};
+
+        // set the pointer first so it's valid as soon as sqlite can call through it, but
+        // restore it if sqlite refuses the new allocator
+        auto previous = current_allocator;
+        current_allocator = &allocator;
+
+        int status = sqlite3_config(SQLITE_CONFIG_MALLOC, &methods);
+        if(status != SQLITE_OK)
+        {
+            current_allocator = previous;
+            throw_config_error("Error setting allocator", status);
+        }
+    }
+
+    void Config::reset_allocator()
+    {
+        if(!default_methods_saved)
+            return;
+
+        int status = sqlite3_config(SQLITE_CONFIG_MALLOC, &default_methods);
+        if(status != SQLITE_OK)
+            throw_config_error("Error resetting allocator", status);
+
+        current_allocator = nullptr;
+    }
+
+    void Config::set_page_cache(int page_size, int pages)
+    {
+        if(pages <= 0)
+        {
+            int status = sqlite3_config(SQLITE_CONFIG_PAGECACHE, nullptr, 0, 0);
+            if(status != SQLITE_OK)
+                throw_config_error("Error setting page cache", status);
+            page_cache_memory.reset();
+            return;
+        }
+
+        // each slot holds a page and its header
+        int header_size = 0;
+        int status = sqlite3_config(SQLITE_CONFIG_PCACHE_HDRSZ, &header_size);
+        if(status != SQLITE_OK)
+            throw_config_error("Error setting page cache", status);
+
+        auto slot_size = page_size + header_size;
+        std::unique_ptr<char[]> page_cache(new char[static_cast<std::size_t>(slot_size) * pages]);
+
+        status = sqlite3_config(SQLITE_CONFIG_PAGECACHE, page_cache.get(), slot_size, pages);
+        if(status != SQLITE_OK)
+            throw_config_error("Error setting page cache", status);
+
+        // sqlite is not initialized, so isn't using the old buffer
+        page_cache_memory = std::move(page_cache);
+    }
+
+    void Config::set_memstatus(bool enable)
+    {
+        int status = sqlite3_config(SQLITE_CONFIG_MEMSTATUS, static_cast<int>(enable));
+        if(status != SQLITE_OK)
+            throw_config_error("Error setting memstatus", status);
+    }
+
+    void Config::set_lookaside(int slot_size, int slots)
+    {
+        int status = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, slot_size, slots);
+        if(status != SQLITE_OK)
+            throw_config_error("Error setting lookaside", status);
+    }
+
+    void Config::initialize()
+    {
+        int status = sqlite3_initialize();
+        if(status != SQLITE_OK)
+            throw Runtime_error("Error initializing sqlite: "s + sqlite3_errstr(status), "", status, nullptr);
+    }
+
+    void Config::shutdown()
+    {
+        int status = sqlite3_shutdown();
+        if(status != SQLITE_OK)
+            throw Runtime_error("Error shutting down sqlite: "s + sqlite3_errstr(status), "", status, nullptr);
+    }
+
+    sqlite3_int64 Config::memory_used()
+    {
+        return sqlite3_memory_used();
+    }
+
+    sqlite3_int64 Config::memory_highwater(bool reset)
+    {
+        return sqlite3_memory_highwater(reset);
+    }
+};
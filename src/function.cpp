@@ -0,0 +1,110 @@
+// registration of C++ callables as SQL functions
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/function.hpp>
+
+#include <exception>
+#include <new>
+
+#include <sqlitepp/error.hpp>
+
+namespace sqlite
+{
+    void Connection::check_function_status(const std::string & name, int status)
+    {
+        if(status == SQLITE_OK)
+            return;
+
+        // misuse errors aren't recorded on the connection
+        auto msg = (sqlite3_errcode(db_) & 0xff) == (status & 0xff) ? sqlite3_errmsg(db_) : sqlite3_errstr(status);
+        throw Logic_error("Error creating function " + name + ": " + msg, "", status, db_);
+    }
+
+    namespace detail
+    {
+        void set_result(sqlite3_context * context, const sqlite3_int64 val)
+        {
+            sqlite3_result_int64(context, val);
+        }
+
+        void set_result(sqlite3_context * context, const double val)
+        {
+            sqlite3_result_double(context, val);
+        }
+
+        void set_result(sqlite3_context * context, const Text_view val)
+        {
+            // a null pointer would give NULL instead of empty text
+            sqlite3_result_text64(context, val.data() ? val.data() : "", val.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+        }
+
+        void set_result(sqlite3_context * context, const std::string & val)
+        {
+            set_result(context, Text_view(val));
+        }
+
+        void set_result(sqlite3_context * context, const char * val)
+        {
+            if(val)
+                set_result(context, Text_view(val));
+            else
+                sqlite3_result_null(context);
+        }
+
+        void set_result(sqlite3_context * context, const Blob_view val)
+        {
+            // a null pointer would give NULL instead of an empty blob
+            sqlite3_result_blob64(context, val.data() ? val.data() : "", val.size(), SQLITE_TRANSIENT);
+        }
+
+        void set_result(sqlite3_context * context, const std::vector<unsigned char> & val)
+        {
+            set_result(context, Blob_view(val));
+        }
+
+        void set_result(sqlite3_context * context, std::nullptr_t)
+        {
+            sqlite3_result_null(context);
+        }
+
+        void set_error(sqlite3_context * context) noexcept
+        {
+            try
+            {
+                throw;
+            }
+            catch(const std::bad_alloc &)
+            {
+                sqlite3_result_error_nomem(context);
+            }
+            catch(const std::exception & e)
+            {
+                sqlite3_result_error(context, e.what(), -1);
+            }
+            catch(...)
+            {
+                sqlite3_result_error(context, "Unknown exception in SQL function", -1);
+            }
+        }
+    };
+};
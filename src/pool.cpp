@@ -0,0 +1,199 @@
+// Thread-safe pool of database connections
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/pool.hpp>
+
+#include <algorithm>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    double Pool::Stats::utilization() const
+    {
+        if(size == 0 || elapsed.count() <= 0)
+            return 0.0;
+
+        return static_cast<double>(total_held.count()) / (static_cast<double>(elapsed.count()) * size);
+    }
+
+    Pool::Pool(const std::string & filename, const Options & options):
+        start_(std::chrono::steady_clock::now())
+    {
+        // open the writer first, so it can create the DB and switch it to WAL mode
+        auto writer_options = options.connection_options;
+        writer_options.journal_mode = "WAL";
+        writer_.connections.push_back(std::make_unique<Connection>(filename, writer_options));
+        writer_.connections.back()->set_statement_cache_size(options.statement_cache_size);
+
+        // readers leave the journal mode alone, as switching it needs a write lock
+        auto reader_options = options.connection_options;
+        reader_options.journal_mode.clear();
+        reader_options.pragmas.push_back("query_only=ON");
+
+        for(std::size_t i = 0; i < options.readers; ++i)
+        {
+            readers_.connections.push_back(std::make_unique<Connection>(filename, reader_options));
+            readers_.connections.back()->set_statement_cache_size(options.statement_cache_size);
+        }
+
+        for(auto group: {&readers_, &writer_})
+        {
+            for(auto & db: group->connections)
+                group->idle.push_back(db.get());
+            group->stats.size = group->connections.size();
+        }
+    }
+
+    Pool::Pool(const std::string & filename): Pool(filename, Options())
+    {
+    }
+
+    Pool::~Pool()
+    {
+    }
+
+    Pool::Lease Pool::reader(std::chrono::milliseconds timeout)
+    {
+        return checkout(readers_, timeout, "reader");
+    }
+
+    Pool::Lease Pool::writer(std::chrono::milliseconds timeout)
+    {
+        return checkout(writer_, timeout, "writer");
+    }
+
+    Pool::Stats Pool::reader_stats() const
+    {
+        return stats(readers_);
+    }
+
+    Pool::Stats Pool::writer_stats() const
+    {
+        return stats(writer_);
+    }
+
+    Pool::Lease Pool::checkout(Group & group, std::chrono::milliseconds timeout, const char * kind)
+    {
+        auto wait_start = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(!group.available.wait_for(lock, timeout, [&group]{ return !group.idle.empty(); }))
+        {
+            ++group.stats.timeouts;
+            lock.unlock();
+            throw Runtime_error("Timed out waiting for pooled "s + kind + " connection", "", SQLITE_BUSY, nullptr);
+        }
+
+        auto db = group.idle.back();
+        group.idle.pop_back();
+
+        auto now = std::chrono::steady_clock::now();
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(now - wait_start);
+        ++group.stats.checkouts;
+        ++group.stats.in_use;
+        group.stats.total_wait += wait;
+        group.stats.max_wait = std::max(group.stats.max_wait, wait);
+
+        Lease lease(this, &group, db);
+        lease.checkout_time_ = now;
+        return lease;
+    }
+
+    void Pool::checkin(Group & group, Connection * db, std::chrono::steady_clock::time_point checkout_time) noexcept
+    {
+        // don't hand the next user a connection with a transaction left open
+        if(!sqlite3_get_autocommit(db->get_c_obj()))
+            sqlite3_exec(db->get_c_obj(), "ROLLBACK;", nullptr, nullptr, nullptr);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            group.idle.push_back(db); // can't throw - capacity is reserved by the initial fill
+            --group.stats.in_use;
+            group.stats.total_held += std::chrono::steady_clock::now() - checkout_time;
+        }
+        group.available.notify_one();
+    }
+
+    Pool::Stats Pool::stats(const Group & group) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto stats = group.stats;
+        stats.elapsed = std::chrono::steady_clock::now() - start_;
+        return stats;
+    }
+
+    Pool::Lease::Lease(Pool * pool, Group * group, Connection * db):
+        pool_(pool),
+        group_(group),
+        db_(db)
+    {
+    }
+
+    Pool::Lease::~Lease()
+    {
+        release();
+    }
+
+    Pool::Lease::Lease(Lease && other):
+        pool_(other.pool_),
+        group_(other.group_),
+        db_(other.db_),
+        checkout_time_(other.checkout_time_)
+    {
+        other.db_ = nullptr;
+    }
+
+    Pool::Lease & Pool::Lease::operator=(Lease && other)
+    {
+        if(&other != this)
+        {
+            release();
+            pool_ = other.pool_;
+            group_ = other.group_;
+            db_ = other.db_;
+            checkout_time_ = other.checkout_time_;
+            other.db_ = nullptr;
+        }
+        return *this;
+    }
+
+    Connection & Pool::Lease::operator*()
+    {
+        return *db_;
+    }
+
+    Connection * Pool::Lease::operator->()
+    {
+        return db_;
+    }
+
+    void Pool::Lease::release() noexcept
+    {
+        if(db_)
+            pool_->checkin(*group_, db_, checkout_time_);
+        db_ = nullptr;
+    }
+};
@@ -0,0 +1,233 @@
+// per-statement latency profiling
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <sqlitepp/sqlite.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace sqlite
+{
+    namespace
+    {
+        // values below 4 get their own bucket. Above that, each power of 2 is split into 4 buckets
+        std::size_t bucket_index(std::uint64_t ns)
+        {
+            if(ns < 4)
+                return ns;
+
+            std::size_t log = 0;
+            for(auto v = ns; v >>= 1;)
+                ++log;
+
+            return 4 * (log - 1) + ((ns >> (log - 2)) & 3);
+        }
+
+        std::uint64_t bucket_upper_bound(std::size_t index)
+        {
+            if(index < 4)
+                return index;
+
+            auto log = index / 4 + 1;
+            auto width = std::uint64_t{1} << (log - 2);
+            return (4 + index % 4) * width + (width - 1);
+        }
+    }
+
+    constexpr std::size_t Connection::Profiler::Histogram::num_buckets;
+
+    void Connection::Profiler::Histogram::add(std::uint64_t ns)
+    {
+        ++buckets[bucket_index(ns)];
+        ++calls;
+        total += ns;
+        max = std::max(max, ns);
+    }
+
+    std::uint64_t Connection::Profiler::Histogram::percentile(double fraction) const
+    {
+        auto target = static_cast<std::uint64_t>(std::ceil(fraction * calls));
+        if(target == 0)
+            target = 1;
+
+        std::uint64_t count = 0;
+        for(std::size_t i = 0; i < num_buckets; ++i)
+        {
+            count += buckets[i];
+            if(count >= target)
+                return std::min(bucket_upper_bound(i), max);
+        }
+        return max;
+    }
+
+    int Connection::Profiler::callback(unsigned int type, void * state_ptr, void * stmt_ptr, void * time) noexcept
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto & state = *static_cast<Profiler *>(state_ptr);
+        auto stmt = static_cast<sqlite3_stmt *>(stmt_ptr);
+
+        std::unique_lock<std::mutex> lock(state.mutex);
+
+        // only a few statements run at once, so a linear search beats a map, and doesn't allocate
+        auto running = std::find_if(std::begin(state.running), std::end(state.running),
+            [stmt](const decltype(state.running)::value_type & entry){ return entry.first == stmt; });
+
+        if(type == SQLITE_TRACE_STMT)
+        {
+            // also reported when triggers start, which shouldn't restart the clock
+            if(running == std::end(state.running))
+            {
+                try
+                {
+                    state.running.emplace_back(stmt, now);
+                }
+                catch(...)
+                {
+                }
+            }
+            return 0;
+        }
+
+        // fall back to sqlite's measurement if the start was missed
+        auto ns = std::chrono::nanoseconds{*static_cast<sqlite3_int64 *>(time)};
+        if(running != std::end(state.running))
+        {
+            ns = now - running->second;
+            *running = state.running.back();
+            state.running.pop_back();
+        }
+
+        // without SQLITE_ENABLE_NORMALIZE, queries differing only in their literals are profiled separately
+#ifdef SQLITE_ENABLE_NORMALIZE
+        auto sql = sqlite3_normalized_sql(stmt);
+        if(!sql)
+            sql = sqlite3_sql(stmt);
+#else
+        auto sql = sqlite3_sql(stmt);
+#endif
+        try
+        {
+            state.key.assign(sql ? sql : "");
+
+            if(state.enabled)
+                state.histograms[state.key].add(ns.count());
+
+            // don't hold the lock while running user code, which may call profile().
+            // key is only written by this callback, which sqlite doesn't run concurrently for one connection
+            lock.unlock();
+
+            if(state.slow_callback && ns >= state.slow_threshold)
+                state.slow_callback(state.key, ns);
+        }
+        catch(...)
+        {
+            // can't report errors from here. Drop the sample
+        }
+
+        return 0;
+    }
+
+    void Connection::update_trace()
+    {
+        if(profiler_ && (profiler_->enabled || profiler_->slow_callback))
+            sqlite3_trace_v2(db_, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, Profiler::callback, profiler_.get());
+        else
+            sqlite3_trace_v2(db_, 0, nullptr, nullptr);
+
+        if(profiler_)
+        {
+            std::lock_guard<std::mutex> lock(profiler_->mutex);
+            profiler_->running.clear();
+        }
+    }
+
+    void Connection::enable_profiling()
+    {
+        if(!profiler_)
+            profiler_ = std::make_unique<Profiler>();
+
+        profiler_->enabled = true;
+        update_trace();
+    }
+
+    void Connection::disable_profiling()
+    {
+        if(!profiler_)
+            return;
+
+        profiler_->enabled = false;
+        update_trace();
+    }
+
+    std::vector<Connection::Query_profile> Connection::profile() const
+    {
+        std::vector<Query_profile> profiles;
+        if(!profiler_)
+            return profiles;
+
+        std::lock_guard<std::mutex> lock(profiler_->mutex);
+
+        profiles.reserve(profiler_->histograms.size());
+        for(auto & entry: profiler_->histograms)
+        {
+            auto & histogram = entry.second;
+
+            Query_profile profile;
+            profile.sql = entry.first;
+            profile.calls = histogram.calls;
+            profile.total = std::chrono::nanoseconds{histogram.total};
+            profile.p50 = std::chrono::nanoseconds{histogram.percentile(0.50)};
+            profile.p99 = std::chrono::nanoseconds{histogram.percentile(0.99)};
+            profile.max = std::chrono::nanoseconds{histogram.max};
+            profiles.push_back(std::move(profile));
+        }
+
+        std::sort(std::begin(profiles), std::end(profiles),
+            [](const Query_profile & a, const Query_profile & b){ return a.total > b.total; });
+
+        return profiles;
+    }
+
+    void Connection::reset_profile()
+    {
+        if(profiler_)
+        {
+            std::lock_guard<std::mutex> lock(profiler_->mutex);
+            profiler_->histograms.clear();
+        }
+    }
+
+    void Connection::set_slow_query_callback(std::chrono::nanoseconds threshold,
+        std::function<void(const std::string & sql, std::chrono::nanoseconds time)> callback)
+    {
+        if(!profiler_)
+        {
+            if(!callback)
+                return;
+            profiler_ = std::make_unique<Profiler>();
+        }
+
+        profiler_->slow_threshold = threshold;
+        profiler_->slow_callback = std::move(callback);
+        update_trace();
+    }
+};
@@ -0,0 +1,140 @@
+// Iteration over statement result rows
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/sqlite.hpp>
+
+namespace sqlite
+{
+    Connection::Stmt::Rows Connection::Stmt::rows()
+    {
+        return Rows(*this);
+    }
+
+    void Connection::Stmt::Row::get(const int column, std::string & val) const
+    {
+        stmt_->get_col(column, val);
+    }
+
+    int Connection::Stmt::Row::column_count() const
+    {
+        return stmt_->column_count();
+    }
+
+    Connection::Stmt & Connection::Stmt::Row::stmt() const
+    {
+        return *stmt_;
+    }
+
+    Connection::Stmt::Row::Row(Stmt * stmt): stmt_(stmt)
+    {
+    }
+
+    Connection::Stmt::Row_iterator::Row_iterator(): row_(nullptr)
+    {
+    }
+
+    Connection::Stmt::Row_iterator::Row_iterator(Stmt & stmt): row_(&stmt)
+    {
+        ++*this;
+    }
+
+    Connection::Stmt::Row_iterator::reference Connection::Stmt::Row_iterator::operator*() const
+    {
+        return row_;
+    }
+
+    Connection::Stmt::Row_iterator::pointer Connection::Stmt::Row_iterator::operator->() const
+    {
+        return &row_;
+    }
+
+    Connection::Stmt::Row_iterator & Connection::Stmt::Row_iterator::operator++()
+    {
+        if(row_.stmt_ && !row_.stmt_->step())
+            row_.stmt_ = nullptr;
+
+        return *this;
+    }
+
+    Connection::Stmt::Row_iterator Connection::Stmt::Row_iterator::operator++(int)
+    {
+        auto prev = *this;
+        ++*this;
+        return prev;
+    }
+
+    bool Connection::Stmt::Row_iterator::operator==(const Row_iterator & other) const
+    {
+        return row_.stmt_ == other.row_.stmt_;
+    }
+
+    bool Connection::Stmt::Row_iterator::operator!=(const Row_iterator & other) const
+    {
+        return !(*this == other);
+    }
+
+    Connection::Stmt::Rows::Rows(Stmt & stmt): stmt_(&stmt)
+    {
+    }
+
+    Connection::Stmt::Rows::~Rows()
+    {
+        reset();
+    }
+
+    Connection::Stmt::Rows::Rows(Rows && other): stmt_(other.stmt_)
+    {
+        other.stmt_ = nullptr;
+    }
+
+    Connection::Stmt::Rows & Connection::Stmt::Rows::operator=(Rows && other)
+    {
+        if(&other != this)
+        {
+            reset();
+            stmt_ = other.stmt_;
+            other.stmt_ = nullptr;
+        }
+        return *this;
+    }
+
+    Connection::Stmt::Row_iterator Connection::Stmt::Rows::begin()
+    {
+        if(!stmt_)
+            return Row_iterator();
+
+        return Row_iterator(*stmt_);
+    }
+
+    Connection::Stmt::Row_iterator Connection::Stmt::Rows::end()
+    {
+        return Row_iterator();
+    }
+
+    void Connection::Stmt::Rows::reset() noexcept
+    {
+        // errors from the last step were already reported by step()
+        if(stmt_)
+            stmt_->try_reset();
+    }
+};
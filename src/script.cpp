@@ -0,0 +1,109 @@
+// Multi-statement SQL scripts
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/script.hpp>
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    Connection::Script::Script(Connection & db, const std::string & sql, bool keep_statements):
+        db_(db.get_c_obj()), sql_(sql), keep_statements_(keep_statements)
+    {
+    }
+
+    void Connection::Script::run(const Callback & callback)
+    {
+        std::size_t index = 0;
+        for(; index < statements_.size(); ++index)
+        {
+            // start from the first row, even if an earlier run was interrupted. Its error was already reported
+            statements_[index].try_reset();
+            run_statement(index, statements_[index], callback);
+        }
+
+        // prepare and run the remaining statements one at a time, so each sees schema changes made by earlier ones
+        auto offset = tail_;
+        while(offset < sql_.size())
+        {
+            sqlite3_stmt * c_stmt = nullptr;
+            const char * tail = nullptr;
+            int status = sqlite3_prepare_v3(db_, sql_.data() + offset, sql_.size() - offset,
+                keep_statements_ ? SQLITE_PREPARE_PERSISTENT : 0, &c_stmt, &tail);
+
+            if(status != SQLITE_OK)
+                throw Logic_error("Error parsing SQL: "s + sqlite3_errmsg(db_), sql_.substr(offset), status, db_);
+
+            offset = tail - sql_.data();
+
+            // whitespace or comments
+            if(!c_stmt)
+                continue;
+
+            Stmt stmt(c_stmt, db_);
+            if(keep_statements_)
+            {
+                statements_.push_back(std::move(stmt));
+                tail_ = offset;
+                run_statement(index++, statements_.back(), callback);
+            }
+            else
+            {
+                run_statement(index++, stmt, callback);
+            }
+        }
+    }
+
+    std::size_t Connection::Script::statement_count() const
+    {
+        return statements_.size();
+    }
+
+    void Connection::Script::clear()
+    {
+        statements_.clear();
+        tail_ = 0;
+    }
+
+    void Connection::Script::run_statement(std::size_t index, Stmt & stmt, const Callback & callback)
+    {
+        // always leave the statement reset, so a kept statement doesn't hold a read transaction open
+        try
+        {
+            for(auto & row: stmt.rows())
+            {
+                if(callback)
+                    callback(index, row);
+            }
+        }
+        catch(...)
+        {
+            stmt.try_reset();
+            throw;
+        }
+
+        stmt.try_reset();
+    }
+};
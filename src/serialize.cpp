@@ -0,0 +1,199 @@
+// DB serialization to and from in-memory images
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/sqlite.hpp>
+
+#if SQLITE_VERSION_NUMBER >= 3036000 || defined(SQLITE_ENABLE_DESERIALIZE)
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SQLITEPP_HAS_MMAP
+#endif
+
+#include <sqlitepp/error.hpp>
+
+using namespace std::string_literals;
+
+namespace sqlite
+{
+    namespace
+    {
+        // read a whole file into sqlite-owned memory
+        unsigned char * read_file(const std::string & path, sqlite3_int64 & size)
+        {
+            auto file = std::fopen(path.c_str(), "rb");
+            if(!file)
+                throw Runtime_error("Error opening DB image (" + path + "): " + std::strerror(errno), "", SQLITE_CANTOPEN, nullptr);
+
+            // pipes and other unseekable files can't report a size
+            if(std::fseek(file, 0, SEEK_END) != 0 || (size = std::ftell(file)) < 0 || std::fseek(file, 0, SEEK_SET) != 0)
+            {
+                auto err = errno;
+                std::fclose(file);
+                throw Runtime_error("Error reading DB image (" + path + "): can't determine size: " + std::strerror(err), "", SQLITE_IOERR_SEEK, nullptr);
+            }
+
+            auto data = static_cast<unsigned char *>(sqlite3_malloc64(size > 0 ? size : 1));
+            if(!data)
+            {
+                std::fclose(file);
+                throw Runtime_error("Error reading DB image (" + path + "): out of memory", "", SQLITE_NOMEM, nullptr);
+            }
+
+            auto read = std::fread(data, 1, size, file);
+            std::fclose(file);
+            if(read != static_cast<std::size_t>(size))
+            {
+                sqlite3_free(data);
+                throw Runtime_error("Error reading DB image (" + path + ")", "", SQLITE_IOERR_READ, nullptr);
+            }
+
+            return data;
+        }
+    }
+
+    std::vector<unsigned char> Connection::serialize(const std::string & db_name)
+    {
+        sqlite3_int64 size = 0;
+        auto data = sqlite3_serialize(db_, db_name.c_str(), &size, 0);
+        if(!data)
+            throw Runtime_error("Error serializing db (" + db_name + "): " + sqlite3_errmsg(db_), "", sqlite3_extended_errcode(db_), db_);
+
+        std::vector<unsigned char> image(data, data + size);
+        sqlite3_free(data);
+        return image;
+    }
+
+    void Connection::serialize_to_file(const std::string & path, const std::string & db_name)
+    {
+        // in-memory DBs can be written out without an extra copy
+        sqlite3_int64 size = 0;
+        auto data = sqlite3_serialize(db_, db_name.c_str(), &size, SQLITE_SERIALIZE_NOCOPY);
+        bool owned = false;
+        if(!data)
+        {
+            data = sqlite3_serialize(db_, db_name.c_str(), &size, 0);
+            owned = true;
+            if(!data)
+                throw Runtime_error("Error serializing db (" + db_name + "): " + sqlite3_errmsg(db_), "", sqlite3_extended_errcode(db_), db_);
+        }
+
+        auto tmp_path = path + ".tmp";
+        auto file = std::fopen(tmp_path.c_str(), "wb");
+        bool ok = file && std::fwrite(data, 1, size, file) == static_cast<std::size_t>(size);
+        auto err = errno;
+        if(file)
+            ok = (std::fclose(file) == 0) && ok;
+
+        if(owned)
+            sqlite3_free(data);
+
+        if(!ok || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+            err = ok ? errno : err;
+            std::remove(tmp_path.c_str());
+            throw Runtime_error("Error writing DB image (" + path + "): " + std::strerror(err), "", SQLITE_IOERR_WRITE, db_);
+        }
+    }
+
+    void Connection::deserialize(const Blob_view image, bool read_only, const std::string & db_name)
+    {
+        auto size = static_cast<sqlite3_int64>(image.size());
+        auto data = static_cast<unsigned char *>(sqlite3_malloc64(size > 0 ? size : 1));
+        if(!data)
+            throw Runtime_error("Error deserializing db (" + db_name + "): out of memory", "", SQLITE_NOMEM, db_);
+
+        if(size > 0)
+            std::memcpy(data, image.data(), size);
+
+        // sqlite frees data, even on failure
+        int status = sqlite3_deserialize(db_, db_name.c_str(), data, size, size, SQLITE_DESERIALIZE_FREEONCLOSE |
+            (read_only ? SQLITE_DESERIALIZE_READONLY : SQLITE_DESERIALIZE_RESIZEABLE));
+        if(status != SQLITE_OK)
+            throw Runtime_error("Error deserializing db (" + db_name + "): " + sqlite3_errmsg(db_), "", status, db_);
+
+        images_.erase(db_name);
+    }
+
+    void Connection::deserialize_file(const std::string & path, bool read_only, const std::string & db_name)
+    {
+#ifdef SQLITEPP_HAS_MMAP
+        if(read_only)
+        {
+            auto fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                throw Runtime_error("Error opening DB image (" + path + "): " + std::strerror(errno), "", SQLITE_CANTOPEN, db_);
+
+            struct stat info;
+            if(::fstat(fd, &info) != 0 || info.st_size <= 0)
+            {
+                ::close(fd);
+                throw Runtime_error("Error opening DB image (" + path + "): empty or unreadable file", "", SQLITE_CANTOPEN, db_);
+            }
+
+            auto size = static_cast<std::size_t>(info.st_size);
+            auto data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(data == MAP_FAILED)
+                throw Runtime_error("Error mapping DB image (" + path + "): " + std::strerror(errno), "", SQLITE_IOERR_MMAP, db_);
+
+            std::shared_ptr<const void> mapping(data, [size](const void * data){ ::munmap(const_cast<void *>(data), size); });
+
+            // sqlite only reads from the buffer, as the DB is read-only
+            int status = sqlite3_deserialize(db_, db_name.c_str(), static_cast<unsigned char *>(data),
+                size, size, SQLITE_DESERIALIZE_READONLY);
+            if(status != SQLITE_OK)
+                throw Runtime_error("Error deserializing db (" + db_name + "): " + sqlite3_errmsg(db_), "", status, db_);
+
+            // without mmap_size, every page is copied into the page cache as it's read
+            images_[db_name] = std::move(mapping);
+
+            std::string schema;
+            for(auto c: db_name)
+                schema += (c == '"') ? "\"\"" : std::string(1, c);
+            exec("PRAGMA \"" + schema + "\".mmap_size=" + std::to_string(size) + ";");
+            return;
+        }
+#endif
+
+        sqlite3_int64 size = 0;
+        auto data = read_file(path, size);
+
+        // sqlite frees data, even on failure
+        int status = sqlite3_deserialize(db_, db_name.c_str(), data, size, size, SQLITE_DESERIALIZE_FREEONCLOSE |
+            (read_only ? SQLITE_DESERIALIZE_READONLY : SQLITE_DESERIALIZE_RESIZEABLE));
+        if(status != SQLITE_OK)
+            throw Runtime_error("Error deserializing db (" + db_name + "): " + sqlite3_errmsg(db_), "", status, db_);
+
+        images_.erase(db_name);
+    }
+};
+
+#endif
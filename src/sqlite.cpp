@@ -24,26 +24,110 @@
 
 #include <sqlitepp/error.hpp>
 
+using namespace std::string_literals;
+
 namespace sqlite
 {
-    Connection::Connection(const std::string & filename)
+    Connection::Connection(const std::string & filename): Connection(filename, Open_options())
+    {
+    }
+
+    Connection::Connection(const std::string & filename, const Open_options & options)
     {
-        int status = sqlite3_open(filename.c_str(), &db_);
+        int status = sqlite3_open_v2(filename.c_str(), &db_, options.flags,
+            options.vfs.empty() ? nullptr : options.vfs.c_str());
         if(status != SQLITE_OK)
         {
+            std::string err = db_ ? sqlite3_errmsg(db_) : sqlite3_errstr(status);
             sqlite3_close(db_);
             throw Runtime_error("Error connecting to db (" +
-                filename + "): " + sqlite3_errmsg(db_), "", status, nullptr);
+                filename + "): " + err, "", status, nullptr);
         }
         sqlite3_extended_result_codes(db_, true);
+
+        // lookaside can only be changed before the connection has used any of it
+        if(options.lookaside_slots >= 0)
+        {
+            status = sqlite3_db_config(db_, SQLITE_DBCONFIG_LOOKASIDE, nullptr,
+                options.lookaside_slot_size, options.lookaside_slots);
+            if(status != SQLITE_OK)
+            {
+                sqlite3_close(db_);
+                db_ = nullptr;
+                throw Runtime_error("Error configuring db (" +
+                    filename + "): could not set lookaside: "s + sqlite3_errstr(status), "", status, nullptr);
+            }
+        }
+
+        // page_size has to be set before switching to WAL mode
+        std::string pragmas;
+        if(options.page_size > 0)
+            pragmas += "PRAGMA page_size=" + std::to_string(options.page_size) + ";";
+        if(!options.journal_mode.empty())
+            pragmas += "PRAGMA journal_mode=" + options.journal_mode + ";";
+        if(!options.synchronous.empty())
+            pragmas += "PRAGMA synchronous=" + options.synchronous + ";";
+        if(options.cache_size != 0)
+            pragmas += "PRAGMA cache_size=" + std::to_string(options.cache_size) + ";";
+        if(options.mmap_size >= 0)
+            pragmas += "PRAGMA mmap_size=" + std::to_string(options.mmap_size) + ";";
+        if(!options.temp_store.empty())
+            pragmas += "PRAGMA temp_store=" + options.temp_store + ";";
+        if(options.foreign_keys >= 0)
+            pragmas += "PRAGMA foreign_keys="s + (options.foreign_keys ? "ON" : "OFF") + ";";
+        for(auto & pragma: options.pragmas)
+            pragmas += "PRAGMA " + pragma + ";";
+
+        if(pragmas.empty())
+            return;
+
+        char * err_msg = nullptr;
+        status = sqlite3_exec(db_, pragmas.c_str(), nullptr, nullptr, &err_msg);
+        if(status != SQLITE_OK)
+        {
+            std::string err = err_msg ? err_msg : sqlite3_errmsg(db_);
+            sqlite3_free(err_msg);
+            sqlite3_close(db_);
+            db_ = nullptr;
+            throw Runtime_error("Error configuring db (" +
+                filename + "): " + err, pragmas, status, nullptr);
+        }
+    }
+
+    Connection::Open_options Connection::Open_options::read_mostly_service()
+    {
+        Open_options options;
+        options.flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+        options.journal_mode = "WAL";
+        options.synchronous = "NORMAL";
+        options.cache_size = -64 * 1024;
+        options.mmap_size = 256 * 1024 * 1024;
+        options.temp_store = "MEMORY";
+        options.foreign_keys = 1;
+        return options;
+    }
+
+    Connection::Open_options Connection::Open_options::bulk_loader()
+    {
+        Open_options options;
+        options.flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+        options.journal_mode = "WAL";
+        options.synchronous = "OFF";
+        options.cache_size = -256 * 1024;
+        options.temp_store = "MEMORY";
+        options.foreign_keys = 0;
+        return options;
     }
 
     Connection::~Connection()
     {
+        // cached statements must be finalized before closing
+        stmt_cache_.reset();
         sqlite3_close(db_);
     }
 
-    Connection::Connection(Connection && other): db_{other.db_}
+    Connection::Connection(Connection && other): db_{other.db_}, stmt_cache_{std::move(other.stmt_cache_)},
+        busy_{std::move(other.busy_)}, profiler_{std::move(other.profiler_)}, images_{std::move(other.images_)}
     {
         other.db_ = nullptr;
     }
@@ -52,16 +136,51 @@ namespace sqlite
     {
         if(&other != this)
         {
+            stmt_cache_.reset();
             sqlite3_close(db_);
             db_ = other.db_;
+            stmt_cache_ = std::move(other.stmt_cache_);
+            busy_ = std::move(other.busy_);
+            profiler_ = std::move(other.profiler_);
+            images_ = std::move(other.images_);
             other.db_ = nullptr;
         }
         return *this;
     }
 
-    Connection::Stmt Connection::create_statement(const std::string & sql)
+    Connection::Stmt Connection::create_statement(const Text_view sql, unsigned int flags)
     {
-        return Stmt(sql, *this);
+        return Stmt(sql, *this, flags);
+    }
+
+    Connection::Cached_stmt Connection::cached_statement(const std::string & sql)
+    {
+        if(!stmt_cache_)
+            return Cached_stmt(sql, Stmt(sql, *this), nullptr);
+
+        return stmt_cache_->lease(sql, *this);
+    }
+
+    void Connection::set_statement_cache_size(std::size_t capacity)
+    {
+        if(!stmt_cache_)
+        {
+            if(capacity == 0)
+                return;
+            stmt_cache_ = std::make_unique<Stmt_cache>(capacity);
+        }
+        else
+        {
+            stmt_cache_->set_capacity(capacity);
+        }
+    }
+
+    Connection::Stmt_cache_stats Connection::statement_cache_stats() const
+    {
+        if(!stmt_cache_)
+            return Stmt_cache_stats{};
+
+        return stmt_cache_->stats();
     }
 
     void Connection::exec(const std::string & sql, int (*callback)(void *, int, char **, char **), void * arg)
@@ -81,6 +200,16 @@ namespace sqlite
         }
     }
 
+    int Connection::try_exec(const char * sql) noexcept
+    {
+        return sqlite3_exec(db_, sql, nullptr, nullptr, nullptr);
+    }
+
+    int Connection::try_exec(const std::string & sql) noexcept
+    {
+        return try_exec(sql.c_str());
+    }
+
     void Connection::begin_transaction()
     {
         exec("BEGIN TRANSACTION;");
@@ -138,6 +267,12 @@ namespace sqlite
         return ret;
     }
 
+    Connection::Blob Connection::open_blob(const std::string & table_name, const std::string & column_name, sqlite3_int64 rowid,
+        bool writable, const std::string & db_name)
+    {
+        return Blob(*this, table_name, column_name, rowid, writable, db_name);
+    }
+
     const sqlite3 * Connection::get_c_obj() const
     {
         return db_;
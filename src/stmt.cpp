@@ -28,23 +28,28 @@ using namespace std::string_literals;
 
 namespace sqlite
 {
-    Connection::Stmt::Stmt(const std::string & sql, Connection & db):
+    Connection::Stmt::Stmt(const Text_view sql, Connection & db, unsigned int flags):
         db_(db.get_c_obj())
     {
-        int status = sqlite3_prepare_v2(db.get_c_obj(), sql.c_str(), sql.length() + 1, &stmt_, NULL);
+        int status = sqlite3_prepare_v3(db.get_c_obj(), sql.data(), sql.size(), flags, &stmt_, NULL);
 
         if(status != SQLITE_OK)
         {
-            throw Logic_error("Error parsing SQL: "s + sqlite3_errmsg(db.get_c_obj()), sql, status, db_);
+            throw Logic_error("Error parsing SQL: "s + sqlite3_errmsg(db.get_c_obj()),
+                std::string(sql.data(), sql.size()), status, db_);
         }
     }
 
+    Connection::Stmt::Stmt(sqlite3_stmt * stmt, sqlite3 * db) noexcept: stmt_(stmt), db_(db)
+    {
+    }
+
     Connection::Stmt::~Stmt()
     {
         sqlite3_finalize(stmt_);
     }
 
-    Connection::Stmt::Stmt(Connection::Stmt && other): stmt_{other.stmt_}, db_{other.db_}
+    Connection::Stmt::Stmt(Connection::Stmt && other): stmt_{other.stmt_}, db_{other.db_}, fetch_done_{other.fetch_done_}
     {
         other.stmt_ = nullptr;
     }
@@ -56,6 +61,7 @@ namespace sqlite
             sqlite3_finalize(stmt_);
             stmt_ = other.stmt_;
             db_ = other.db_;
+            fetch_done_ = other.fetch_done_;
             other.stmt_ = nullptr;
         }
         return *this;
@@ -64,62 +70,58 @@ namespace sqlite
 
     void Connection::Stmt::bind(const int index, const double val)
     {
-        int status = sqlite3_bind_double(stmt_, index, val);
+        int status = try_bind(index, val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding index " +
-                std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(index, status);
     }
 
     void Connection::Stmt::bind(const int index, const int val)
     {
-        int status = sqlite3_bind_int(stmt_, index, val);
+        int status = try_bind(index, val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding index " +
-                std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(index, status);
     }
 
     void Connection::Stmt::bind(const int index, const sqlite3_int64 val)
     {
-        int status = sqlite3_bind_int64(stmt_, index, val);
+        int status = try_bind(index, val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding index " +
-                std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(index, status);
     }
 
     void Connection::Stmt::bind(const int index, const std::string & val)
     {
-        int status = sqlite3_bind_text(stmt_, index, val.c_str(), val.length(), SQLITE_TRANSIENT);
+        int status = try_bind(index, val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding index " +
-                std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(index, status);
     }
 
     void Connection::Stmt::bind(const int index, const char * val)
     {
-        int status = sqlite3_bind_text(stmt_, index, val, -1, SQLITE_TRANSIENT);
+        int status = try_bind(index, val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding index " +
-                std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(index, status);
+    }
+
+    void Connection::Stmt::bind(const int index, const Text_view val, sqlite3_destructor_type destructor)
+    {
+        int status = try_bind(index, val, destructor);
+        if(status != SQLITE_OK)
+            throw_bind_error(index, status);
+    }
+
+    void Connection::Stmt::bind(const int index, const Blob_view val, sqlite3_destructor_type destructor)
+    {
+        int status = try_bind(index, val, destructor);
+        if(status != SQLITE_OK)
+            throw_bind_error(index, status);
     }
 
     void Connection::Stmt::bind_null(const int index)
     {
-        int status = sqlite3_bind_null(stmt_, index);
+        int status = try_bind_null(index);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding index " +
-                std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(index, status);
     }
 
     void Connection::Stmt::bind(const int index)
@@ -127,64 +129,69 @@ namespace sqlite
         bind_null(index);
     }
 
+    void Connection::Stmt::bind_zeroblob(const int index, const sqlite3_uint64 size)
+    {
+        int status = try_bind_zeroblob(index, size);
+        if(status != SQLITE_OK)
+            throw_bind_error(index, status);
+    }
+
     void Connection::Stmt::bind(const std::string & name, const double val)
     {
-        int status = sqlite3_bind_double(stmt_, bind_parameter_index(name), val);
+        int status = try_bind(bind_parameter_index(name), val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding " + name +
-                ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(name, status);
     }
 
     void Connection::Stmt::bind(const std::string & name, const int val)
     {
-        int status = sqlite3_bind_int(stmt_, bind_parameter_index(name), val);
+        int status = try_bind(bind_parameter_index(name), val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding " + name +
-                ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(name, status);
     }
 
     void Connection::Stmt::bind(const std::string & name, const sqlite3_int64 val)
     {
-        int status = sqlite3_bind_int64(stmt_, bind_parameter_index(name), val);
+        int status = try_bind(bind_parameter_index(name), val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding " + name +
-                ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(name, status);
     }
 
     void Connection::Stmt::bind(const std::string & name, const std::string & val)
     {
-        int status = sqlite3_bind_text(stmt_, bind_parameter_index(name), val.c_str(), val.length(), SQLITE_TRANSIENT);
+        int status = try_bind(bind_parameter_index(name), val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding " + name +
-                ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(name, status);
     }
 
     void Connection::Stmt::bind(const std::string & name, const char * val)
     {
-        int status = sqlite3_bind_text(stmt_, bind_parameter_index(name), val, -1, SQLITE_TRANSIENT);
+        int status = try_bind(bind_parameter_index(name), val);
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding " + name +
-                ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(name, status);
+    }
+
+    void Connection::Stmt::bind(const std::string & name, const Text_view val, sqlite3_destructor_type destructor)
+    {
+        // look up the index without throwing, so sqlite still calls destructor on an unknown name
+        int status = try_bind(sqlite3_bind_parameter_index(stmt_, name.c_str()), val, destructor);
+        if(status != SQLITE_OK)
+            throw_bind_error(name, status);
+    }
+
+    void Connection::Stmt::bind(const std::string & name, const Blob_view val, sqlite3_destructor_type destructor)
+    {
+        // look up the index without throwing, so sqlite still calls destructor on an unknown name
+        int status = try_bind(sqlite3_bind_parameter_index(stmt_, name.c_str()), val, destructor);
+        if(status != SQLITE_OK)
+            throw_bind_error(name, status);
     }
 
     void Connection::Stmt::bind_null(const std::string & name)
     {
-        int status = sqlite3_bind_null(stmt_, bind_parameter_index(name));
+        int status = try_bind_null(bind_parameter_index(name));
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error binding " + name +
-                ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_bind_error(name, status);
     }
 
     void Connection::Stmt::bind(const std::string & name)
@@ -192,6 +199,81 @@ namespace sqlite
         bind_null(name);
     }
 
+    void Connection::Stmt::bind_zeroblob(const std::string & name, const sqlite3_uint64 size)
+    {
+        int status = try_bind_zeroblob(bind_parameter_index(name), size);
+        if(status != SQLITE_OK)
+            throw_bind_error(name, status);
+    }
+
+    void Connection::Stmt::bind_null(const Param param)
+    {
+        bind_null(param.index());
+    }
+
+    void Connection::Stmt::bind_zeroblob(const Param param, const sqlite3_uint64 size)
+    {
+        bind_zeroblob(param.index(), size);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const double val) noexcept
+    {
+        return sqlite3_bind_double(stmt_, index, val);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const int val) noexcept
+    {
+        return sqlite3_bind_int(stmt_, index, val);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const sqlite3_int64 val) noexcept
+    {
+        return sqlite3_bind_int64(stmt_, index, val);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const std::string & val) noexcept
+    {
+        return sqlite3_bind_text(stmt_, index, val.c_str(), val.length(), SQLITE_TRANSIENT);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const char * val) noexcept
+    {
+        return sqlite3_bind_text(stmt_, index, val, -1, SQLITE_TRANSIENT);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const Text_view val, sqlite3_destructor_type destructor) noexcept
+    {
+        // a null pointer would bind NULL instead of empty text. The literal must not be passed to the caller's destructor
+        if(!val.data())
+            return sqlite3_bind_text64(stmt_, index, "", 0, SQLITE_STATIC, SQLITE_UTF8);
+
+        return sqlite3_bind_text64(stmt_, index, val.data(), val.size(), destructor, SQLITE_UTF8);
+    }
+
+    int Connection::Stmt::try_bind(const int index, const Blob_view val, sqlite3_destructor_type destructor) noexcept
+    {
+        // a null pointer would bind NULL instead of an empty blob. The literal must not be passed to the caller's destructor
+        if(!val.data())
+            return sqlite3_bind_blob64(stmt_, index, "", 0, SQLITE_STATIC);
+
+        return sqlite3_bind_blob64(stmt_, index, val.data(), val.size(), destructor);
+    }
+
+    int Connection::Stmt::try_bind_null(const int index) noexcept
+    {
+        return sqlite3_bind_null(stmt_, index);
+    }
+
+    int Connection::Stmt::try_bind(const int index) noexcept
+    {
+        return try_bind_null(index);
+    }
+
+    int Connection::Stmt::try_bind_zeroblob(const int index, const sqlite3_uint64 size) noexcept
+    {
+        return sqlite3_bind_zeroblob64(stmt_, index, size);
+    }
+
     std::string Connection::Stmt::bind_parameter_name(const int index)
     {
         const char * name = sqlite3_bind_parameter_name(stmt_, index);
@@ -214,14 +296,50 @@ namespace sqlite
         return index;
     }
 
+    Connection::Stmt::Param Connection::Stmt::param(const std::string & name)
+    {
+        return Param(bind_parameter_index(name));
+    }
+
     int Connection::Stmt::bind_parameter_count()
     {
         return sqlite3_bind_parameter_count(stmt_);
     }
 
+    int Connection::Stmt::column_count()
+    {
+        return sqlite3_column_count(stmt_);
+    }
+
+    void Connection::Stmt::check_bind_count(std::size_t count)
+    {
+        auto expected = static_cast<std::size_t>(sqlite3_bind_parameter_count(stmt_));
+        if(count != expected)
+        {
+            throw Logic_error("Wrong number of bind values: expected " +
+                std::to_string(expected) + ", got " + std::to_string(count), sqlite3_sql(stmt_), SQLITE_RANGE, db_);
+        }
+    }
+
+    void Connection::Stmt::check_column_count(std::size_t count)
+    {
+        auto expected = static_cast<std::size_t>(sqlite3_column_count(stmt_));
+        if(count != expected)
+        {
+            throw Logic_error("Wrong number of columns: expected " +
+                std::to_string(expected) + ", got " + std::to_string(count), sqlite3_sql(stmt_), SQLITE_RANGE, db_);
+        }
+    }
+
+    void Connection::Stmt::throw_mapping_error(std::size_t fields, int count, const char * what)
+    {
+        throw Logic_error("Wrong number of "s + what + " for mapped struct: struct has " + std::to_string(fields) +
+            " fields, statement has " + std::to_string(count) + " " + what, sqlite3_sql(stmt_), SQLITE_RANGE, db_);
+    }
+
     bool Connection::Stmt::step()
     {
-        int status = sqlite3_step(stmt_);
+        int status = try_step();
         if(status == SQLITE_ROW)
         {
             return true;
@@ -232,11 +350,15 @@ namespace sqlite
         }
         else
         {
-            throw Logic_error("Error evaluating SQL: "s +
-                sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
+            throw_error("Error evaluating SQL: ", status);
         }
     }
 
+    int Connection::Stmt::try_step() noexcept
+    {
+        return sqlite3_step(stmt_);
+    }
+
     /// @name Get columns
     /// get_col() template specializations
     /// @{
@@ -272,7 +394,7 @@ namespace sqlite
         if(!str)
             return ""s; // empty str for NULL data
         else
-            return std::string(str);
+            return std::string(str, sqlite3_column_bytes(stmt_, column));
     }
 
     /// @copydoc sqlite::Connection::Stmt::get_col()
@@ -282,16 +404,52 @@ namespace sqlite
         return reinterpret_cast<const char *>(sqlite3_column_text(stmt_, column));
     }
 
+    /// @copydoc sqlite::Connection::Stmt::get_col()
+    /// @note The returned view is only valid until the next call to step() or reset(),
+    /// or until the column is read again as a different type
+    template<>
+    Text_view Connection::Stmt::get_col<Text_view>(const int column)
+    {
+        // must get text before bytes, in case sqlite needs to convert the value to text
+        const char * str = reinterpret_cast<const char *>(sqlite3_column_text(stmt_, column));
+        return Text_view(str, sqlite3_column_bytes(stmt_, column));
+    }
+
+    /// @copydoc sqlite::Connection::Stmt::get_col()
+    /// @note The returned view is only valid until the next call to step() or reset(),
+    /// or until the column is read again as a different type
+    template<>
+    Blob_view Connection::Stmt::get_col<Blob_view>(const int column)
+    {
+        const void * data = sqlite3_column_blob(stmt_, column);
+        return Blob_view(data, sqlite3_column_bytes(stmt_, column));
+    }
+
     /// @}
 
+    void Connection::Stmt::get_col(const int column, std::string & val)
+    {
+        auto str = get_col<Text_view>(column);
+        val.assign(str.begin(), str.end());
+    }
+
+    void Connection::Stmt::get_col(const int column, std::vector<unsigned char> & val)
+    {
+        auto data = get_col<Blob_view>(column);
+        val.assign(data.begin(), data.end());
+    }
+
     void Connection::Stmt::reset()
     {
-        int status = sqlite3_reset(stmt_);
+        int status = try_reset();
         if(status != SQLITE_OK)
-        {
-            throw Logic_error("Error resetting statement: "s +
-                sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
-        }
+            throw_error("Error resetting statement: ", status);
+    }
+
+    int Connection::Stmt::try_reset() noexcept
+    {
+        fetch_done_ = false;
+        return sqlite3_reset(stmt_);
     }
 
     void Connection::Stmt::clear_bindings()
@@ -309,6 +467,71 @@ namespace sqlite
         return bool(sqlite3_stmt_readonly(stmt_));
     }
 
+    Connection::Stmt::Status Connection::Stmt::status(bool reset)
+    {
+        Status status;
+        status.fullscan_steps = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_FULLSCAN_STEP, reset);
+        status.sorts = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_SORT, reset);
+        status.autoindexes = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_AUTOINDEX, reset);
+        status.vm_steps = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_VM_STEP, reset);
+        status.reprepares = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_REPREPARE, reset);
+        status.runs = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_RUN, reset);
+        status.memory_used = sqlite3_stmt_status(stmt_, SQLITE_STMTSTATUS_MEMUSED, false);
+        return status;
+    }
+
+    std::vector<Connection::Stmt::Scan_status> Connection::Stmt::scan_status(bool reset)
+    {
+        std::vector<Scan_status> loops;
+
+#ifdef SQLITE_ENABLE_STMT_SCANSTATUS
+        for(int i = 0;; ++i)
+        {
+            Scan_status loop;
+            const char * name = nullptr;
+            const char * explain = nullptr;
+
+            // returns non-zero once i is past the last loop
+            if(sqlite3_stmt_scanstatus(stmt_, i, SQLITE_SCANSTAT_NLOOP, &loop.loops))
+                break;
+
+            sqlite3_stmt_scanstatus(stmt_, i, SQLITE_SCANSTAT_NVISIT, &loop.rows_visited);
+            sqlite3_stmt_scanstatus(stmt_, i, SQLITE_SCANSTAT_EST, &loop.estimated_rows);
+            sqlite3_stmt_scanstatus(stmt_, i, SQLITE_SCANSTAT_SELECTID, &loop.select_id);
+            sqlite3_stmt_scanstatus(stmt_, i, SQLITE_SCANSTAT_NAME, &name);
+            sqlite3_stmt_scanstatus(stmt_, i, SQLITE_SCANSTAT_EXPLAIN, &explain);
+
+            if(name)
+                loop.name = name;
+            if(explain)
+                loop.explain = explain;
+
+            loops.push_back(std::move(loop));
+        }
+
+        if(reset)
+            sqlite3_stmt_scanstatus_reset(stmt_);
+#else
+        (void)reset;
+#endif
+
+        return loops;
+    }
+
+    const char * Connection::Stmt::sql() const
+    {
+        return sqlite3_sql(stmt_);
+    }
+
+    const char * Connection::Stmt::normalized_sql() const
+    {
+#ifdef SQLITE_ENABLE_NORMALIZE
+        return sqlite3_normalized_sql(stmt_);
+#else
+        return nullptr;
+#endif
+    }
+
     const sqlite3_stmt * Connection::Stmt::get_c_obj() const
     {
         return stmt_;
@@ -318,4 +541,24 @@ namespace sqlite
     {
         return stmt_;
     }
+
+    // kept out of line so the callers' success paths stay small. The message and SQL are
+    // copied when thrown, as the Stmt may be finalized during unwinding, and any later sqlite
+    // call on the connection overwrites sqlite3_errmsg, before the exception is caught
+    void Connection::Stmt::throw_bind_error(const int index, const int status)
+    {
+        throw Logic_error("Error binding index " +
+            std::to_string(index) + ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
+    }
+
+    void Connection::Stmt::throw_bind_error(const std::string & name, const int status)
+    {
+        throw Logic_error("Error binding " + name +
+            ": " + sqlite3_errmsg(db_), sqlite3_sql(stmt_), status, db_);
+    }
+
+    void Connection::Stmt::throw_error(const char * what, const int status)
+    {
+        throw Logic_error(what + std::string(sqlite3_errmsg(db_)), sqlite3_sql(stmt_), status, db_);
+    }
 };
@@ -0,0 +1,168 @@
+// Prepared statement cache
+
+// Copyright 2019 Matthew Chandler
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <sqlitepp/sqlite.hpp>
+
+#include <sqlitepp/error.hpp>
+
+namespace sqlite
+{
+    Connection::Stmt_cache::Stmt_cache(std::size_t capacity):
+        capacity_(capacity)
+    {
+        stats_.capacity = capacity_;
+    }
+
+    Connection::Cached_stmt Connection::Stmt_cache::lease(const std::string & sql, Connection & db)
+    {
+        auto found = index_.find(sql);
+        if(found == std::end(index_))
+        {
+            ++stats_.misses;
+            // cached statements are long-lived, so keep them out of lookaside memory
+            return Cached_stmt(sql, Stmt(sql, db, SQLITE_PREPARE_PERSISTENT), this);
+        }
+
+        ++stats_.hits;
+        auto entry = found->second;
+        index_.erase(found);
+
+        Cached_stmt leased(std::move(entry->first), std::move(entry->second), this);
+        lru_.erase(entry);
+        stats_.size = lru_.size();
+
+        return leased;
+    }
+
+    void Connection::Stmt_cache::put(const std::string & sql, Stmt && stmt) noexcept
+    {
+        // errors from the last step are reported by reset, and have already been seen by the caller
+        stmt.try_reset();
+        sqlite3_clear_bindings(stmt.get_c_obj());
+
+        if(capacity_ == 0 || index_.count(sql))
+            return; // let stmt finalize when it goes out of scope
+
+        // on allocation failure, drop the statement rather than throwing from a Cached_stmt destructor
+        try
+        {
+            lru_.emplace_front(sql, std::move(stmt));
+        }
+        catch(...)
+        {
+            return;
+        }
+
+        try
+        {
+            index_.emplace(sql, std::begin(lru_));
+        }
+        catch(...)
+        {
+            lru_.pop_front();
+            return;
+        }
+
+        evict();
+    }
+
+    void Connection::Stmt_cache::set_capacity(std::size_t capacity)
+    {
+        capacity_ = capacity;
+        stats_.capacity = capacity_;
+        evict();
+    }
+
+    void Connection::Stmt_cache::clear()
+    {
+        index_.clear();
+        lru_.clear();
+        stats_.size = 0;
+    }
+
+    Connection::Stmt_cache_stats Connection::Stmt_cache::stats() const
+    {
+        return stats_;
+    }
+
+    void Connection::Stmt_cache::evict()
+    {
+        while(lru_.size() > capacity_)
+        {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+            ++stats_.evictions;
+        }
+        stats_.size = lru_.size();
+    }
+
+    Connection::Cached_stmt::Cached_stmt(std::string sql, Stmt && stmt, Stmt_cache * cache):
+        sql_(std::move(sql)),
+        stmt_(std::move(stmt)),
+        cache_(cache)
+    {
+    }
+
+    Connection::Cached_stmt::~Cached_stmt()
+    {
+        release();
+    }
+
+    Connection::Cached_stmt::Cached_stmt(Cached_stmt && other):
+        sql_(std::move(other.sql_)),
+        stmt_(std::move(other.stmt_)),
+        cache_(other.cache_)
+    {
+        other.cache_ = nullptr;
+    }
+
+    Connection::Cached_stmt & Connection::Cached_stmt::operator=(Cached_stmt && other)
+    {
+        if(&other != this)
+        {
+            release();
+            sql_ = std::move(other.sql_);
+            stmt_ = std::move(other.stmt_);
+            cache_ = other.cache_;
+            other.cache_ = nullptr;
+        }
+        return *this;
+    }
+
+    Connection::Stmt & Connection::Cached_stmt::operator*()
+    {
+        return stmt_;
+    }
+
+    Connection::Stmt * Connection::Cached_stmt::operator->()
+    {
+        return &stmt_;
+    }
+
+    void Connection::Cached_stmt::release() noexcept
+    {
+        if(cache_ && stmt_.get_c_obj())
+            cache_->put(sql_, std::move(stmt_));
+        cache_ = nullptr;
+    }
+};